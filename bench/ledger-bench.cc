@@ -0,0 +1,296 @@
+#include <benchmark/benchmark.h>
+
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "analytics-store.h"
+#include "normalize.h"
+#include "record.h"
+#include "record-list-model.h"
+
+namespace {
+
+// stands in for firestore::FieldValue, Get() returns by value like the sdk does
+struct Fake_value {
+	std::string string;
+	int64_t integer = 0;
+	double real = 0;
+
+	const std::string & string_value() const noexcept { return string; }
+	int64_t integer_value() const noexcept { return integer; }
+	double double_value() const noexcept { return real; }
+};
+
+// a daily record document; the day totals reuse the record's own numbers
+struct Fake_doc {
+	std::string id;
+	std::string date;
+	std::string name;
+	int64_t bale_sold = 0;
+	int64_t weight_sold = 0;
+	double rate = 0;
+	int64_t amount = 0;
+	int64_t received_amount = 0;
+
+	Fake_value Get(const std::string & field) const {
+
+		if(field == "date") return {date};
+		if(field == "name") return {name};
+		if(field == "baleSold" || field == "totalBaleSold") return {{}, bale_sold};
+		if(field == "weightSold" || field == "totalWeightSold") return {{}, weight_sold};
+		if(field == "rate") return {{}, 0, rate};
+		if(field == "amount" || field == "totalAmount") return {{}, amount};
+		if(field == "receivedAmount" || field == "totalReceivedAmount") return {{}, received_amount};
+
+		return {};
+	}
+};
+
+const QStringList FIRST_NAMES = {"Ahmed", "Bilal", "Fatima", "Hassan", "Imran", "Kamran", "Nadia", "Omar", "Sana", "Zain"};
+const QStringList LAST_NAMES = {"Ali", "Butt", "Chaudhry", "Khan", "Malik", "Qureshi", "Raza", "Shah", "Sheikh", "Siddiqui"};
+
+// the same seed every run so numbers are comparable between builds
+std::mt19937 & generator() {
+	static std::mt19937 generator(42);
+	return generator;
+}
+
+QString random_name() {
+	std::uniform_int_distribution<int> pick(0, 9);
+	return "  " + FIRST_NAMES[pick(generator())] + " " + LAST_NAMES[pick(generator())] + " ";
+}
+
+QString random_date() {
+	std::uniform_int_distribution<int> day(1, 28);
+	std::uniform_int_distribution<int> month(1, 12);
+	std::uniform_int_distribution<int> year(2020, 2026);
+
+	return QString::number(day(generator())) + "-" + QString::number(month(generator())) + "-" + QString::number(year(generator()));
+}
+
+std::vector<Fake_doc> make_docs(const int64_t count) {
+	std::uniform_int_distribution<int> quantity(1, 500);
+	std::vector<Fake_doc> docs;
+	docs.reserve(static_cast<size_t>(count));
+
+	for(int64_t i = 0; i < count; ++i) {
+		Fake_doc doc;
+		doc.id = "record" + std::to_string(i);
+
+		doc.date = random_date().toStdString();
+		doc.name = random_name().toStdString();
+		doc.bale_sold = quantity(generator());
+		doc.weight_sold = doc.bale_sold * 40;
+		doc.rate = 12.5;
+		doc.amount = doc.weight_sold * 12;
+		doc.received_amount = doc.weight_sold * 10;
+
+		docs.push_back(std::move(doc));
+	}
+
+	return docs;
+}
+
+QList<Record> make_records(const int64_t count) {
+	QList<Record> records;
+	records.reserve(static_cast<qsizetype>(count));
+
+	for(const auto & doc : make_docs(count)) {
+		records.append(decode_record(doc, doc.id));
+	}
+
+	return records;
+}
+
+void dataset_sizes(benchmark::internal::Benchmark * benchmark) {
+
+	for(const int64_t size : {1'000, 10'000, 100'000, 1'000'000}) {
+		benchmark->Arg(size);
+	}
+
+	benchmark->Unit(benchmark::kMillisecond);
+}
+
+void BM_normalize_name(benchmark::State & state) {
+	QStringList names;
+
+	for(int64_t i = 0; i < state.range(0); ++i) {
+		names.append(random_name());
+	}
+
+	for(auto _ : state) {
+
+		for(const auto & name : names) {
+			benchmark::DoNotOptimize(normalize_name(name));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_normalize_date(benchmark::State & state) {
+	QStringList dates;
+
+	for(int64_t i = 0; i < state.range(0); ++i) {
+		dates.append(random_date());
+	}
+
+	for(auto _ : state) {
+
+		for(const auto & date : dates) {
+			benchmark::DoNotOptimize(normalize_date(date));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the decode loop of get_daily_records and the user history pages
+void BM_decode_records(benchmark::State & state) {
+	const auto docs = make_docs(state.range(0));
+
+	for(auto _ : state) {
+		QList<Record> records;
+		records.reserve(static_cast<qsizetype>(docs.size()));
+
+		for(const auto & doc : docs) {
+			records.append(decode_record(doc, doc.id));
+		}
+
+		benchmark::DoNotOptimize(records.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the shape every response and the qml side work with
+void BM_records_to_variant_maps(benchmark::State & state) {
+	const auto records = make_records(state.range(0));
+
+	for(auto _ : state) {
+		QVariantList list;
+		list.reserve(records.size());
+
+		for(const auto & record : records) {
+			list.append(record.to_variant_map());
+		}
+
+		benchmark::DoNotOptimize(list.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// user history ordered newest day first, as read_user_view sorts a whole history and each month bucket
+void BM_sort_user_history(benchmark::State & state) {
+	const auto records = make_records(state.range(0));
+
+	for(auto _ : state) {
+		state.PauseTiming();
+		auto sorted = records;
+		state.ResumeTiming();
+
+		std::sort(sorted.begin(), sorted.end(), [](const Record & lhs, const Record & rhs) {
+			const auto lhs_day = normalize_date(lhs.date);
+			const auto rhs_day = normalize_date(rhs.date);
+			return lhs_day != rhs_day ? lhs_day > rhs_day : lhs.doc_id > rhs.doc_id;
+		});
+
+		benchmark::DoNotOptimize(sorted.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the range scan fallback for months without a rollup
+void BM_monthly_summation(benchmark::State & state) {
+	const auto docs = make_docs(state.range(0));
+
+	for(auto _ : state) {
+		int64_t total_bale_sold = 0;
+		int64_t total_weight_sold = 0;
+		int64_t total_amount = 0;
+		int64_t total_received_amount = 0;
+
+		for(const auto & doc : docs) {
+			total_bale_sold += doc.Get("totalBaleSold").integer_value();
+			total_weight_sold += doc.Get("totalWeightSold").integer_value();
+			total_amount += doc.Get("totalAmount").integer_value();
+			total_received_amount += doc.Get("totalReceivedAmount").integer_value();
+		}
+
+		benchmark::DoNotOptimize(total_bale_sold + total_weight_sold + total_amount + total_received_amount);
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_model_set_records(benchmark::State & state) {
+	const auto records = make_records(state.range(0));
+	Record_list_model model;
+
+	for(auto _ : state) {
+		model.set_records(records);
+		benchmark::DoNotOptimize(model.count());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// live updates arrive one record at a time
+void BM_model_add_record(benchmark::State & state) {
+	const auto records = make_records(state.range(0));
+
+	for(auto _ : state) {
+		state.PauseTiming();
+		Record_list_model model;
+		state.ResumeTiming();
+
+		for(const auto & record : records) {
+			model.add_record(record);
+		}
+
+		benchmark::DoNotOptimize(model.count());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the analytics view's sales by customer by month over every loaded record
+void BM_analytics_group_by(benchmark::State & state) {
+	Analytics_store store;
+
+	for(const auto & record : make_records(state.range(0))) {
+		store.append(record);
+	}
+
+	for(auto _ : state) {
+		const auto rows = store.select({});
+		const auto groups = store.group_by(rows, Analytics_store::Dimension::Customer, Analytics_store::Dimension::Month, 5);
+
+		benchmark::DoNotOptimize(groups.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_normalize_name)->Apply(dataset_sizes);
+BENCHMARK(BM_normalize_date)->Apply(dataset_sizes);
+BENCHMARK(BM_decode_records)->Apply(dataset_sizes);
+BENCHMARK(BM_records_to_variant_maps)->Apply(dataset_sizes);
+BENCHMARK(BM_sort_user_history)->Apply(dataset_sizes);
+BENCHMARK(BM_monthly_summation)->Apply(dataset_sizes);
+BENCHMARK(BM_model_set_records)->Apply(dataset_sizes);
+BENCHMARK(BM_model_add_record)->Apply(dataset_sizes);
+BENCHMARK(BM_analytics_group_by)->Apply(dataset_sizes);
+
+BENCHMARK_MAIN();
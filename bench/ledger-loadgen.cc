@@ -0,0 +1,307 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "firebase.h"
+#include "latency-tracer.h"
+#include "memory-backend.h"
+
+struct Load {
+	QString backend;
+	// sales per second of this counter
+	double rate = 0;
+	qint64 duration_ms = 0;
+	qint64 drain_ms = 0;
+	int customers = 0;
+	int latency_ms = 0;
+	int jitter_ms = 0;
+	int counter = 0;
+};
+
+// one simulated counter with a backend, and for firestore a journal, of its own. prints a line per accepted
+// sale, "sale <answer us> <commit us>" with the commit -1 when the sale had not reached the store by the end
+static int run_counter(QCoreApplication & app, const Load & load) {
+	std::unique_ptr<Ledger_backend> backend;
+
+	if(load.backend == "firestore") {
+		backend = std::make_unique<Firebase>();
+	} else {
+		auto memory = std::make_unique<Memory_backend>();
+		memory->set_latency(load.latency_ms, load.jitter_ms);
+		backend = std::move(memory);
+	}
+
+	const auto * firebase = qobject_cast<Firebase*>(backend.get());
+
+	if(firebase && firebase->journal_busy()) {
+		qCritical() << "Counter" << load.counter << "found its journal in use by another run.";
+		return 1;
+	}
+
+	struct Sale {
+		qint64 sent_ns = 0;
+		qint64 answer_us = 0;
+		qint64 commit_us = -1;
+	};
+
+	QElapsedTimer clock;
+	QHash<qint64, qint64> sent_at_ns;
+	std::vector<Sale> sales;
+	// answered sales the store does not have yet, oldest first. the journal replays in the order it was written
+	std::deque<size_t> uncommitted;
+	qint64 issued = 0;
+	qint64 failed = 0;
+	qint64 last_answer_ns = 0;
+	bool draining = false;
+
+	const auto settled = [&]() {
+		return draining && sent_at_ns.isEmpty() && uncommitted.empty();
+	};
+
+	QObject::connect(backend.get(), &Ledger_backend::addRecordResponse, [&](const QVariantMap & response) {
+		const auto it = sent_at_ns.find(response["loadgenSeq"].toLongLong());
+
+		if(it == sent_at_ns.end()) {
+			return;
+		}
+
+		last_answer_ns = clock.nsecsElapsed();
+
+		Sale sale;
+		sale.sent_ns = it.value();
+		sale.answer_us = (last_answer_ns - it.value()) / 1000;
+		sent_at_ns.erase(it);
+
+		if(response["error"].toBool()) {
+			++failed;
+		} else {
+
+			if(firebase) {
+				uncommitted.push_back(sales.size());
+			} else {
+				// the memory backend answers once the sale is stored
+				sale.commit_us = sale.answer_us;
+			}
+
+			sales.push_back(sale);
+		}
+
+		if(settled()) {
+			app.quit();
+		}
+	});
+
+	if(firebase) {
+
+		QObject::connect(firebase, &Firebase::journalChanged, [&]() {
+			const auto now_ns = clock.nsecsElapsed();
+
+			while(uncommitted.size() > static_cast<size_t>(firebase->pending_writes())) {
+				auto & sale = sales[uncommitted.front()];
+				sale.commit_us = (now_ns - sale.sent_ns) / 1000;
+				uncommitted.pop_front();
+			}
+
+			if(settled()) {
+				app.quit();
+			}
+		});
+	}
+
+	const auto today = QDate::currentDate().toString("dd-MM-yyyy");
+	auto * random = QRandomGenerator::global();
+
+	// a fine tick that issues however many sales are due, so high rates are not capped by timer resolution
+	QTimer driver;
+	driver.setTimerType(Qt::PreciseTimer);
+	driver.setInterval(1);
+
+	QObject::connect(&driver, &QTimer::timeout, [&]() {
+		const auto elapsed_ms = clock.elapsed();
+		const auto due = std::min(static_cast<qint64>(static_cast<double>(elapsed_ms) * load.rate / 1000.0),
+			static_cast<qint64>(static_cast<double>(load.duration_ms) * load.rate / 1000.0));
+
+		for(; issued < due; ++issued) {
+			const auto customer = random->bounded(load.customers);
+			const auto bale_sold = random->bounded(1, 50);
+			const auto weight_sold = bale_sold * 40;
+
+			QVariantMap sale;
+			sale["date"] = today;
+			sale["name"] = "Loadgen Customer " + QString::number(customer);
+			sale["phone"] = "0300" + QString::number(customer).rightJustified(7, '0');
+			sale["baleSold"] = bale_sold;
+			sale["weightSold"] = weight_sold;
+			sale["rate"] = 12.5;
+			sale["amount"] = weight_sold * 12;
+			sale["receivedAmount"] = weight_sold * 10;
+			sale["loadgenSeq"] = issued;
+			sale["loadgenCounter"] = load.counter;
+
+			sent_at_ns[issued] = clock.nsecsElapsed();
+			backend->add_record(sale);
+		}
+
+		if(elapsed_ms < load.duration_ms) {
+			return;
+		}
+
+		driver.stop();
+		draining = true;
+
+		if(settled()) {
+			return app.quit();
+		}
+
+		// give the stragglers and the journal's replay a moment, then report whatever got through
+		QTimer::singleShot(load.drain_ms, &app, &QCoreApplication::quit);
+	});
+
+	clock.start();
+	driver.start();
+	app.exec();
+
+	for(const auto & sale : sales) {
+		std::printf("sale %lld %lld\n", static_cast<long long>(sale.answer_us), static_cast<long long>(sale.commit_us));
+	}
+
+	std::printf("issued %lld\n", static_cast<long long>(issued));
+	std::printf("failed %lld\n", static_cast<long long>(failed));
+	std::printf("unanswered %lld\n", static_cast<long long>(sent_at_ns.size()));
+	std::printf("elapsed %lld\n", static_cast<long long>(last_answer_ns / 1000));
+
+	return 0;
+}
+
+// replays sales against a backend at a fixed rate from several simulated counters, each a process of its own
+// with its own backend and journal like the machines at the counters. reports the latency of add_record's
+// answer and, end to end, of each sale's commit to the store
+int main(int argc, char ** argv) {
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.addHelpOption();
+
+	const QCommandLineOption backend_option("backend", "memory, or firestore to write real sales into the configured project.", "backend", "memory");
+	const QCommandLineOption rate_option("rate", "Sales per second across all counters.", "rate", "200");
+	const QCommandLineOption counters_option("counters", "Simulated counters recording sales.", "counters", "8");
+	const QCommandLineOption duration_option("duration", "Seconds to generate load for.", "seconds", "30");
+	const QCommandLineOption drain_option("drain", "Seconds to wait afterwards for answers and commits still outstanding.", "seconds", "30");
+	const QCommandLineOption customers_option("customers", "Distinct customers the sales are spread over.", "customers", "500");
+	const QCommandLineOption latency_option("latency", "Injected latency of the memory backend in ms.", "ms", "20");
+	const QCommandLineOption jitter_option("jitter", "Extra random latency of the memory backend, up to this many ms.", "ms", "30");
+	const QCommandLineOption counter_option("counter", "Run as this one counter, the load generator starts these itself.", "index");
+
+	parser.addOptions({backend_option, rate_option, counters_option, duration_option, drain_option, customers_option, latency_option, jitter_option, counter_option});
+	parser.process(app);
+
+	const auto counters = std::max(1, parser.value(counters_option).toInt());
+
+	if(parser.isSet(counter_option)) {
+		Load load;
+		load.backend = parser.value(backend_option);
+		load.rate = std::max(1e-3, parser.value(rate_option).toDouble());
+		load.duration_ms = std::max(1, parser.value(duration_option).toInt()) * 1000LL;
+		load.drain_ms = std::max(0, parser.value(drain_option).toInt()) * 1000LL;
+		load.customers = std::max(1, parser.value(customers_option).toInt());
+		load.latency_ms = parser.value(latency_option).toInt();
+		load.jitter_ms = parser.value(jitter_option).toInt();
+		load.counter = parser.value(counter_option).toInt();
+
+		// a journal and settings of its own, away from the real app's and the other counters'
+		app.setApplicationName("Bale Ledger Loadgen " + QString::number(load.counter));
+
+		return run_counter(app, load);
+	}
+
+	const auto rate = std::max(1.0, parser.value(rate_option).toDouble());
+	std::vector<std::unique_ptr<QProcess>> processes;
+
+	for(int counter = 0; counter < counters; ++counter) {
+		auto process = std::make_unique<QProcess>();
+		process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+		process->start(QCoreApplication::applicationFilePath(), {
+			"--counter", QString::number(counter),
+			"--backend", parser.value(backend_option),
+			"--rate", QString::number(rate / counters, 'g', 10),
+			"--duration", parser.value(duration_option),
+			"--drain", parser.value(drain_option),
+			"--customers", parser.value(customers_option),
+			"--latency", parser.value(latency_option),
+			"--jitter", parser.value(jitter_option)
+		});
+
+		processes.push_back(std::move(process));
+	}
+
+	Latency_histogram answers;
+	Latency_histogram commits;
+	qint64 issued = 0;
+	qint64 failed = 0;
+	qint64 unanswered = 0;
+	qint64 uncommitted = 0;
+	qint64 elapsed_us = 0;
+	bool crashed = false;
+
+	for(const auto & process : processes) {
+
+		if(!process->waitForFinished(-1) || process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0) {
+			crashed = true;
+		}
+
+		for(const auto & line : process->readAllStandardOutput().split('\n')) {
+			const auto fields = line.split(' ');
+
+			if(fields.size() == 3 && fields[0] == "sale") {
+				answers.record(fields[1].toLongLong());
+
+				if(const auto commit_us = fields[2].toLongLong(); commit_us >= 0) {
+					commits.record(commit_us);
+				} else {
+					++uncommitted;
+				}
+
+			} else if(fields.size() == 2 && fields[0] == "issued") {
+				issued += fields[1].toLongLong();
+			} else if(fields.size() == 2 && fields[0] == "failed") {
+				failed += fields[1].toLongLong();
+			} else if(fields.size() == 2 && fields[0] == "unanswered") {
+				unanswered += fields[1].toLongLong();
+			} else if(fields.size() == 2 && fields[0] == "elapsed") {
+				elapsed_us = std::max(elapsed_us, fields[1].toLongLong());
+			}
+		}
+	}
+
+	const auto ms = [](const int64_t us) {
+		return static_cast<double>(us) / 1e3;
+	};
+
+	std::printf("backend      %s\n", qPrintable(parser.value(backend_option)));
+	std::printf("issued       %lld sales from %d counters\n", static_cast<long long>(issued), counters);
+	std::printf("answered     %lld (%lld failed, %lld unanswered)\n", static_cast<long long>(answers.count()), static_cast<long long>(failed),
+		static_cast<long long>(unanswered));
+	std::printf("committed    %lld (%lld still journaled)\n", static_cast<long long>(commits.count()), static_cast<long long>(uncommitted));
+	std::printf("throughput   %.1f sales/s\n", static_cast<double>(answers.count()) / std::max(1e-9, static_cast<double>(elapsed_us) / 1e6));
+
+	// the answer comes once the journal has the sale, the commit once the store does
+	std::printf("answer  p50 %.2f ms  p99 %.2f ms  p999 %.2f ms  max %.2f ms\n",
+		ms(answers.percentile(0.50)), ms(answers.percentile(0.99)), ms(answers.percentile(0.999)), ms(answers.max()));
+	std::printf("commit  p50 %.2f ms  p99 %.2f ms  p999 %.2f ms  max %.2f ms\n",
+		ms(commits.percentile(0.50)), ms(commits.percentile(0.99)), ms(commits.percentile(0.999)), ms(commits.max()));
+
+	return !crashed && failed == 0 && unanswered == 0 && uncommitted == 0 ? 0 : 1;
+}
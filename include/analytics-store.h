@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "record.h"
+
+// records held column by column for ad-hoc breakdowns. names are dictionary encoded and days kept as
+// ordinals, so a filter or a group-by is a tight loop over a few integer arrays. gui thread only
+class Analytics_store {
+public:
+	enum class Dimension { None, Customer, Month, Rate };
+
+	// both ends inclusive, days are Range_index ordinals
+	struct Filter {
+		int64_t from_day = std::numeric_limits<int64_t>::min();
+		int64_t to_day = std::numeric_limits<int64_t>::max();
+		// -1 keeps every customer
+		int32_t customer = -1;
+	};
+
+	struct Group {
+		// -1 for the dimensions the breakdown is not by
+		int32_t customer = -1;
+		int32_t month = -1;
+		int32_t rate_bucket = -1;
+
+		int64_t records = 0;
+		int64_t bale_sold = 0;
+		int64_t weight_sold = 0;
+		int64_t amount = 0;
+		int64_t received_amount = 0;
+	};
+
+	size_t size() const noexcept { return days_.size(); }
+	int customers() const noexcept { return static_cast<int>(names_.size()); }
+
+	void clear() noexcept;
+	void reserve(size_t records) noexcept;
+	// false when the record's date is not a valid day
+	bool append(const Record & record) noexcept;
+
+	// -1 for a name no record carries
+	int32_t customer_id(const QString & name) const noexcept;
+	const QString & customer_name(int32_t id) const noexcept { return names_[static_cast<size_t>(id)]; }
+
+	// the rows that pass the filter, in storage order
+	std::vector<uint32_t> select(const Filter & filter) const noexcept;
+
+	// the selected rows summed per distinct pair of keys. rates fall in buckets rate_width wide
+	std::vector<Group> group_by(const std::vector<uint32_t> & rows, Dimension first, Dimension second, float rate_width) const noexcept;
+
+	// months as year * 12 + month - 1
+	static int32_t month_ordinal(const std::string & day) noexcept;
+
+private:
+	struct Keys {
+		std::vector<uint32_t> values;
+		uint32_t cardinality = 1;
+		int32_t offset = 0;
+	};
+
+	Keys keys_of(const std::vector<uint32_t> & rows, Dimension dimension, float rate_width) const noexcept;
+
+	template<typename Column>
+	static void sum_into(std::vector<int64_t> & sums, const Column & column, const std::vector<uint32_t> & rows, const std::vector<uint32_t> & groups) noexcept {
+
+		for(size_t i = 0; i < rows.size(); ++i) {
+			sums[groups[i]] += column[rows[i]];
+		}
+	}
+
+	// groups up to this many possible keys are found through a flat table, more through a hash
+	constexpr static uint64_t DENSE_GROUPS = 1 << 20;
+	// rates past the last bucket share it, so a wild imported rate still fits a group's int32_t bucket
+	constexpr static uint32_t MAX_RATE_BUCKET = 1 << 30;
+
+	std::vector<int64_t> days_;
+	std::vector<int32_t> months_;
+	std::vector<uint32_t> customers_;
+	std::vector<int32_t> bale_sold_;
+	std::vector<int32_t> weight_sold_;
+	std::vector<float> rates_;
+	std::vector<int32_t> amounts_;
+	std::vector<int32_t> received_amounts_;
+
+	// normalized name -> id, and the name as first seen for each id
+	QHash<QString, uint32_t> ids_;
+	std::vector<QString> names_;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <firebase/firestore.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// collects the writes of several mutations so every document is written once,
+// with the increments aimed at the same field summed into a single FieldValue::Increment
+class Coalesced_writes {
+public:
+	void increment(const firebase::firestore::DocumentReference & doc, const std::string & field, const int64_t delta) noexcept {
+		merged(doc).increments[field] += delta;
+	}
+
+	void set_field(const firebase::firestore::DocumentReference & doc, const std::string & field, firebase::firestore::FieldValue value) noexcept {
+		merged(doc).fields[field] = std::move(value);
+	}
+
+	// one key of a map field, merged into the stored map alongside the other keys set this way.
+	// FieldValue::Delete() removes the key
+	void set_map_entry(const firebase::firestore::DocumentReference & doc, const std::string & field, const std::string & key,
+		firebase::firestore::FieldValue value) noexcept {
+		merged(doc).maps[field][key] = std::move(value);
+	}
+
+	// later calls for the same document win
+	void set(const firebase::firestore::DocumentReference & doc, firebase::firestore::MapFieldValue data) noexcept {
+		auto & write = replaced_[doc.path()];
+		write.doc = doc;
+		write.data = std::move(data);
+		write.deleted = false;
+	}
+
+	void remove(const firebase::firestore::DocumentReference & doc) noexcept {
+		auto & write = replaced_[doc.path()];
+		write.doc = doc;
+		write.data.clear();
+		write.deleted = true;
+	}
+
+	// number of document writes apply() will issue
+	size_t size() const noexcept { return merged_.size() + replaced_.size(); }
+
+	template<typename Writer>
+	void apply(Writer & writer) const {
+		using firebase::firestore::FieldValue;
+		using firebase::firestore::SetOptions;
+
+		for(const auto & [path, write] : replaced_) {
+
+			if(write.deleted) {
+				writer.Delete(write.doc);
+			} else {
+				writer.Set(write.doc, write.data);
+			}
+		}
+
+		for(const auto & [path, write] : merged_) {
+			auto data = write.fields;
+
+			for(const auto & [field, delta] : write.increments) {
+				data[field] = FieldValue::Increment(delta);
+			}
+
+			for(const auto & [field, entries] : write.maps) {
+				data[field] = FieldValue::Map(entries);
+			}
+
+			writer.Set(write.doc, data, SetOptions::Merge());
+		}
+	}
+
+private:
+	struct Merged_write {
+		firebase::firestore::DocumentReference doc;
+		firebase::firestore::MapFieldValue fields;
+		std::map<std::string, int64_t> increments;
+		std::map<std::string, firebase::firestore::MapFieldValue> maps;
+	};
+
+	struct Replaced_write {
+		firebase::firestore::DocumentReference doc;
+		firebase::firestore::MapFieldValue data;
+		bool deleted = false;
+	};
+
+	Merged_write & merged(const firebase::firestore::DocumentReference & doc) noexcept {
+		auto & write = merged_[doc.path()];
+		write.doc = doc;
+		return write;
+	}
+
+	std::map<std::string, Merged_write> merged_;
+	std::map<std::string, Replaced_write> replaced_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+
+#include <vector>
+
+// every customer kept in memory, sorted by normalized name, for network-free autocomplete
+class Customer_index : public QObject {
+	Q_OBJECT
+public:
+	struct Customer {
+		QString key;
+		QString name;
+		QString phone;
+		// whether the customer's history is complete in their month buckets
+		bool months = false;
+	};
+
+	explicit Customer_index(QObject * parent = nullptr) noexcept;
+
+	bool loaded() const noexcept { return loaded_; }
+	int size() const noexcept { return static_cast<int>(customers_.size()); }
+
+	void reset(std::vector<Customer> customers) noexcept;
+	void upsert(const Customer & customer) noexcept;
+	void remove(const QString & key) noexcept;
+
+	// null when the key is not indexed
+	const Customer * find(const QString & key) const noexcept;
+
+	std::vector<Customer> find_prefix(const QString & prefix, int limit) const noexcept;
+
+	struct Match {
+		Customer customer;
+		// "prefix", "phone" or "fuzzy"
+		QString kind;
+		int distance = 0;
+	};
+
+	// prefixes of the name first, then names within a few typos of the query, closest first. a query with
+	// digits in it matches phone numbers containing them instead
+	std::vector<Match> rank(const QString & query, int limit) const noexcept;
+
+	// coalesces keystrokes, searchFinished fires once typing pauses
+	void search(const QString & query, int limit) noexcept;
+
+signals:
+	void searchFinished(const QVariantMap & response);
+
+private:
+	void run_search() noexcept;
+
+	constexpr static int DEBOUNCE_MS = 60;
+	// a query may be this many characters per allowed typo
+	constexpr static int CHARS_PER_TYPO = 3;
+
+	std::vector<Customer> customers_;
+	bool loaded_ = false;
+
+	QTimer debounce_;
+	QString pending_query_;
+	int pending_limit_ = 0;
+};
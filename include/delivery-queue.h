@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQuickWindow>
+
+#include <atomic>
+#include <functional>
+
+// hands closures from the sdk threads to the gui thread. producers never lock: closures go on an intrusive
+// mpsc list (vyukov's) and the first one after a drain schedules the next drain. with a window the drain
+// runs once per frame, before the scene is synchronized, so everything that arrived during the frame
+// updates the models together
+class Delivery_queue {
+public:
+	using Apply = std::function<void()>;
+
+	explicit Delivery_queue(QObject * owner) noexcept;
+	~Delivery_queue() noexcept;
+
+	Delivery_queue(const Delivery_queue &) = delete;
+	Delivery_queue & operator=(const Delivery_queue &) = delete;
+
+	// any thread
+	void post(Apply apply) noexcept;
+
+	// drain on the window's frames instead of a posted event of its own. gui thread
+	void set_window(QQuickWindow * window) noexcept;
+
+	// runs everything posted so far, in order. gui thread
+	void drain() noexcept;
+
+private:
+	struct Node {
+		std::atomic<Node*> next{nullptr};
+		Apply apply;
+	};
+
+	void push(Node * node) noexcept;
+	Node * pop() noexcept;
+	void schedule() noexcept;
+
+	QObject * owner_ = nullptr;
+	QPointer<QQuickWindow> window_;
+	QMetaObject::Connection frame_connection_;
+
+	std::atomic<bool> scheduled_{false};
+	std::atomic<Node*> head_;
+	// consumer side only
+	Node * tail_ = nullptr;
+	Node stub_;
+};
@@ -1,69 +1,558 @@
 #pragma once
 
 #include <QObject>
+#include <QStringList>
+#include <QTimer>
 #include <QNetworkAccessManager>
 #include <firebase/app.h>
 
 #include <firebase/firestore.h>
 
-class Firebase : public QObject {
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+
+#include "ledger-backend.h"
+#include "record-list-model.h"
+#include "journal.h"
+#include "latency-tracer.h"
+#include "lru-cache.h"
+#include "analytics-store.h"
+#include "coalesced-writes.h"
+#include "customer-index.h"
+#include "delivery-queue.h"
+#include "normalize.h"
+#include "pending-read.h"
+#include "range-index.h"
+#include "read-cache.h"
+#include "record-rows.h"
+#include "sharded-counters.h"
+
+// the firestore backend: writes go through the local journal first, reads come from firestore
+class Firebase : public Ledger_backend {
 	Q_OBJECT
+	Q_PROPERTY(int pendingWrites READ pending_writes NOTIFY journalChanged)
+	Q_PROPERTY(int lastReplayLatency READ last_replay_latency NOTIFY journalChanged)
+	Q_PROPERTY(bool liveUpdates READ live_updates WRITE set_live_updates NOTIFY liveUpdatesChanged)
+	Q_PROPERTY(Latency_tracer * tracer READ tracer CONSTANT)
+	Q_PROPERTY(QString warehouse READ warehouse WRITE set_warehouse NOTIFY warehouseChanged)
+	Q_PROPERTY(QStringList warehouses READ warehouses NOTIFY warehousesChanged)
 public:
 	Firebase() noexcept;
+	~Firebase() noexcept override;
+
+	int pending_writes() const noexcept { return journal_.depth(); }
+	bool journal_busy() const noexcept { return journal_.busy(); }
+	int last_replay_latency() const noexcept { return last_replay_latency_ms_; }
+
+	Latency_tracer * tracer() noexcept { return &tracer_; }
+
+	// responses reach qml once per frame of window rather than one event each
+	void deliver_on_frames(QQuickWindow * window) noexcept { delivery_.set_window(window); }
+
+	bool live_updates() const noexcept { return live_updates_; }
+	void set_live_updates(bool live_updates) noexcept;
+
+	// off, reads skip the early answer from firestore's local cache and answer once, from the server.
+	// for callers that want one authoritative response per call rather than a quick paint
+	void set_cached_paints(bool cached_paints) noexcept { cached_paints_ = cached_paints; }
+
+	// the site whose stock and days every view and new record uses. "main" keeps its collections at the
+	// root, any other site under warehouses/<id>. customers are shared by all sites
+	QString warehouse() const noexcept { return QString::fromStdString(warehouse_); }
+	void set_warehouse(const QString & warehouse) noexcept;
+	QStringList warehouses() const noexcept;
+
+	// the warehouse the next Firebase opens on
+	static void set_default_warehouse(const QString & warehouse) noexcept;
+
+	Q_INVOKABLE void add_warehouse(const QString & warehouse) noexcept;
+
+	// every site's totals for a DD-MM-YYYY day or a month, read from all sites at once and merged
+	Q_INVOKABLE void get_consolidated_daily_totals(const QString & date) noexcept;
+	Q_INVOKABLE void get_consolidated_monthly_totals(int month, int year) noexcept;
+
+	void get_bale() noexcept override;
+	void set_bale(int bale_amount, int bale_weight) noexcept override;
+
+	void add_record(const QVariantMap & data) noexcept override;
+	void get_daily_records(const QString & date) noexcept override;
+
+	// keeps the day's totals, its records and the stock current through snapshot listeners,
+	// replacing any previous subscription
+	Q_INVOKABLE void subscribe_daily_records(const QString & date) noexcept;
+	Q_INVOKABLE void unsubscribe_daily_records() noexcept;
+
+	void get_user_records(const QString & name) noexcept override;
+	Q_INVOKABLE void get_more_user_records() noexcept;
+
+	// the name of the customer a query, e.g. a phone number, matches best, ranked now rather than after the
+	// debounced search. empty when nothing matches or the customers are not loaded yet
+	Q_INVOKABLE QString best_customer(const QString & query) const noexcept;
+
+	void delete_record(const QVariantMap & data) noexcept override;
+
+	void get_users(const QString & prefix, int limit = 10) noexcept override;
+	void get_monthly_totals(int month, int year) noexcept override;
+	Q_INVOKABLE void get_yearly_totals(const int year) noexcept;
+
+	// totals of every day from one DD-MM-YYYY date to another, both inclusive. answered from a local index of
+	// the daily totals that is read once and then follows this app's commits
+	Q_INVOKABLE void get_range_totals(const QString & from, const QString & to) noexcept;
+
+	// rereads the daily totals, picking up what other counters recorded since the index was loaded
+	Q_INVOKABLE void refresh_range_index() noexcept;
+
+	// one-shot maintenance: rebuilds monthly_totals and yearly_totals from the daily documents.
+	// overwrites the rollups, so run it while no other counter is recording sales
+	Q_INVOKABLE void backfill_rollups() noexcept;
+
+	// maintenance: rebuilds every customer's users/<name>/months buckets from their records and marks them
+	// monthsComplete, after which their history loads a page of months at a time. also derives firstSaleDay and
+	// lastPaymentDay for the aging report. safe while sales are recorded
+	Q_INVOKABLE void backfill_user_months() noexcept;
+
+	// offline maintenance: recounts every customer's records into recordCount and removes customers without any
+	Q_INVOKABLE void sweep_users() noexcept;
+
+	// one-shot maintenance: adds the sortable day field to records written before it existed and marks every
+	// customer daysComplete. until then the history of a customer without month buckets is read whole
+	Q_INVOKABLE void backfill_record_days() noexcept;
 
-	Q_INVOKABLE void get_bale() noexcept;
-	Q_INVOKABLE void set_bale(int bale_amount, int bale_weight) noexcept;
+	// spreads the increments of a hot counter ("stock", "daily", "monthly" or "yearly") over up to 16 documents.
+	// takes effect with the next replayed batch and is remembered across runs
+	Q_INVOKABLE void set_counter_shards(const QString & counter, int shards) noexcept;
 
-	Q_INVOKABLE void add_record(const QVariantMap & data) noexcept;
-	Q_INVOKABLE void get_daily_records(const QString & date) noexcept;
+	// the n customers owing the most, a single ordered query over the users
+	Q_INVOKABLE void get_top_debtors(int n) noexcept;
 
-	Q_INVOKABLE void get_user_records(const QString & name) noexcept;
+	// outstanding debt split into 0-30, 31-60 and 60+ days since the customer's last payment,
+	// or their first sale if they never paid. reads only the users in debt, not their records
+	Q_INVOKABLE void get_debt_aging() noexcept;
 
-	Q_INVOKABLE void delete_record(const QVariantMap & data) noexcept;
+	// reads the records of every day from one DD-MM-YYYY date to another into the analytics store,
+	// replacing what it held. several days are read at once
+	Q_INVOKABLE void load_analytics(const QString & from, const QString & to) noexcept;
 
-	Q_INVOKABLE void get_users(const QString & prefix) noexcept;
-	Q_INVOKABLE void get_monthly_totals(const int month, const int year) noexcept;
+	// a breakdown of the loaded records. query holds by and then ("customer", "month", "rate" or nothing),
+	// optional from/to dates and customer name, and rateWidth, the width of a rate bucket
+	Q_INVOKABLE void get_analytics(const QVariantMap & query) noexcept;
+
+	// streams the records of every day from one DD-MM-YYYY date to another into path, csv for *.csv and
+	// ndjson otherwise, one page of a day at a time
+	Q_INVOKABLE void export_records(const QString & from, const QString & to, const QString & path) noexcept;
+
+	// adds every valid row of an exported file the way add_record does, several transactions in flight at once.
+	// each one marks itself done under imports/<file hash>, so running it again after a failure only
+	// commits the chunks that did not land
+	Q_INVOKABLE void import_records(const QString & path) noexcept;
+
+	// size of firestore's on-disk cache, which lets a view paint before the server answers. applies from the next start
+	static void set_local_cache_size(int megabytes) noexcept;
+
+	// how long identical reads are answered from memory, 0 only coalesces the ones in flight. remembered across runs
+	Q_INVOKABLE void set_read_cache_ttl(int ttl_ms) noexcept;
+
+	// days on each side of a shown day read ahead of time, 0 turns it off. remembered across runs
+	Q_INVOKABLE void set_prefetch_days(int days) noexcept;
 
 signals:
-	void setBaleResponse(const QVariantMap & response);
-	void getBaleResponse(const QVariantMap & response);
+	void getMoreUserRecordsResponse(const QVariantMap & response);
 
-	void addRecordResponse(const QVariantMap & response);
+	void warehouseChanged();
+	void warehousesChanged();
+	void addWarehouseResponse(const QVariantMap & response);
+	void getConsolidatedTotalsResponse(const QVariantMap & response);
 
-	void getDailyRecordsResponseMetadata(const QVariantMap & response);
-	void getDailyRecordsResponse(const QVariantMap & response);
+	void getYearlyTotalsResponse(const QVariantMap & response);
+	void getRangeTotalsResponse(const QVariantMap & response);
+	void backfillRollupsResponse(const QVariantMap & response);
+	void sweepUsersResponse(const QVariantMap & response);
+	void backfillUserMonthsResponse(const QVariantMap & response);
+	void getTopDebtorsResponse(const QVariantMap & response);
+	void getDebtAgingResponse(const QVariantMap & response);
+	void loadAnalyticsProgress(const QVariantMap & progress);
+	void loadAnalyticsResponse(const QVariantMap & response);
+	void getAnalyticsResponse(const QVariantMap & response);
+	void exportRecordsProgress(const QVariantMap & progress);
+	void exportRecordsResponse(const QVariantMap & response);
+	void importRecordsProgress(const QVariantMap & progress);
+	void importRecordsResponse(const QVariantMap & response);
+	void backfillRecordDaysResponse(const QVariantMap & response);
 
-	void getUserRecordsResponseMetadata(const QVariantMap & response);
-	void getUserRecordsResponse(const QVariantMap & response);
+	// the sdk is up, emitted once
+	void firestoreStarted();
 
-	void deleteRecordResponse(const QVariantMap & response);
-	void getUsersResponse(const QVariantMap & response);
+	void journalChanged();
+	// an entry the store refused for good, set aside so the ones behind it can go out
+	void journalEntryRejected(const QVariantMap & response);
+	void liveUpdatesChanged();
 
-	void getMonthlyTotalsResponse(const QVariantMap & response);
+	void dailyTotalsChanged(const QVariantMap & response);
+	void stockChanged(const QVariantMap & response);
 
 private:
+	struct Record_refs {
+		firebase::firestore::DocumentReference daily_doc;
+		// the daily document itself, or the shard this batch increments
+		firebase::firestore::DocumentReference daily_counter;
+		firebase::firestore::DocumentReference daily_record;
+		firebase::firestore::DocumentReference monthly;
+		firebase::firestore::DocumentReference yearly;
+		firebase::firestore::DocumentReference user_doc;
+		firebase::firestore::DocumentReference user_record;
+		// the customer's bucket for the record's month
+		firebase::firestore::DocumentReference user_month;
+		firebase::firestore::DocumentReference stock;
+	};
+
+	struct Counter_shards {
+		int stock = 1;
+		int daily = 1;
+		int monthly = 1;
+		int yearly = 1;
+	};
+
+	// runs on its own thread while the ui loads, warehouse is the site it prefetches from
+	void start_firestore(const std::string & warehouse) noexcept;
+	void on_firestore_started() noexcept;
+
+	// the store, waiting for start_firestore when called before it finished
+	firebase::firestore::Firestore * db() const noexcept {
+		db_ready_.wait();
+		return db_.get();
+	}
+
+	Record_refs record_refs(const std::string & warehouse, const QString & date, const QString & name, const std::string & doc_id,
+		const Counter_shards & shards, uint32_t shard_salt) const noexcept;
+
+	// a collection of one site. takes the instance, so it works before db() would stop waiting
+	static firebase::firestore::CollectionReference site_collection(firebase::firestore::Firestore * db, const std::string & warehouse, const char * name) noexcept;
+
+	// a collection of the current site. gui thread only, sdk callbacks take the warehouse they started with
+	firebase::firestore::CollectionReference site(const char * name) const noexcept {
+		return site_collection(db(), warehouse_, name);
+	}
+
+	// entries journaled before there were several sites carry none and belong to the main one
+	static std::string entry_warehouse(const Journal::Entry & entry) noexcept;
+
+	void load_warehouses() noexcept;
+	// sums fields over the counter of every site, reading them all at once
+	void read_all_sites(const std::function<firebase::firestore::DocumentReference(const std::string &)> & counter_of,
+		std::function<void(const std::vector<std::pair<std::string, Sharded_counters::Result>> &)> callback) noexcept;
+	void answer_consolidated(QVariantMap response, const Latency_tracer::Span & span,
+		const std::vector<std::pair<std::string, Sharded_counters::Result>> & sites) noexcept;
+
+	static void stage_totals(Coalesced_writes & writes, const firebase::firestore::DocumentReference & doc, const Record & record, int sign) noexcept;
+	// a record as its customer's month bucket keeps it
+	static firebase::firestore::FieldValue bucket_entry(const Record & record) noexcept;
+	// without the customer's side when they already have the record, as one imported into a second site does
+	static void stage_add_record(Coalesced_writes & writes, const Record_refs & refs, const Record & record, const QString & phone,
+		bool to_user = true) noexcept;
+	static void stage_delete_record(Coalesced_writes & writes, const Record_refs & refs, const Record & record) noexcept;
+
+	// YYYYMMDD days kept on the customer for debt aging. no FieldValue transform keeps a minimum or maximum,
+	// so the writers read them in their transaction
+	struct User_dates {
+		bool exists = false;
+		std::string first_sale;
+		std::string last_payment;
+	};
+
+	static User_dates user_dates(const firebase::firestore::DocumentSnapshot & user) noexcept;
+	// widens dates to cover record, staging the days that moved. a customer seen for the first time
+	// is also marked monthsComplete, every record of theirs will be in the month buckets
+	static void stage_user_dates(Coalesced_writes & writes, const firebase::firestore::DocumentReference & user_doc, User_dates & dates, const Record & record) noexcept;
+
+	void schedule_replay() noexcept;
+	void replay_journal() noexcept;
+	// commits a batch, skipping the records an earlier attempt already landed
+	void commit_replay(const std::vector<Journal::Entry> & entries, const Counter_shards & shards, const std::string & warehouse,
+		const Latency_tracer::Span & span) noexcept;
+	void on_journal_entries_replayed(const std::vector<Journal::Entry> & entries, firebase::firestore::Error error, const QString & message,
+		const std::vector<std::pair<Record, int>> & applied) noexcept;
+	// errors a retry cannot fix, e.g. a rule or a malformed field, as opposed to the network or contention
+	static bool permanent_error(firebase::firestore::Error error) noexcept;
+	// what keeps an entry from being replayed, empty when nothing does
+	static QString malformed_entry(const Journal::Entry & entry) noexcept;
+	void reject_entry(const Journal::Entry & entry, const QString & reason) noexcept;
+
+	struct Daily_totals {
+		bool error = false;
+		std::map<std::string, Range_index::Totals> days;
+		// shards of the monthly and yearly rollups seen along the way
+		std::vector<firebase::firestore::DocumentReference> rollup_shards;
+	};
+
+	// every day's totals, base documents and shards summed. the callback runs on an sdk thread
+	void read_daily_totals(std::function<void(const Daily_totals &)> callback) noexcept;
+
+	void load_range_index() noexcept;
+	void answer_range_queries() noexcept;
+
+	void sum_monthly_daily_records(const firebase::firestore::CollectionReference & daily_ref, int month, int year, const QString & read_key, const Latency_tracer::Span & span) noexcept;
+	static QVariantMap totals_response(const Sharded_counters::Totals & totals) noexcept;
+
 	QVariantMap add_record_to_users(const QVariantMap & data) noexcept;
-	void cleanup_empty_users() noexcept;
+	void cleanup_empty_user(const QString & name) noexcept;
+
+	// a day's view as get_daily_records delivers it
+	struct Daily_view {
+		std::string day;
+		bool error = false;
+		QVariantMap metadata;
+		// unset when the totals already told the day is empty or unreadable
+		std::optional<QVariantMap> response;
+		QList<Record> records;
+
+		QVariant fingerprint() const noexcept;
+	};
+
+	// startup_records and startup_totals hand over the reads made while firestore was starting
+	void read_daily_view(const firebase::firestore::DocumentReference & day_doc, firebase::firestore::Source source,
+		const firebase::Future<firebase::firestore::QuerySnapshot> & startup_records, bool startup_totals,
+		std::function<void(const Daily_view &)> callback) noexcept;
+	static Daily_view daily_view(const std::string & day, const Sharded_counters::Result & totals,
+		const firebase::Future<firebase::firestore::QuerySnapshot> & records) noexcept;
+	void deliver_daily_view(const Daily_view & view, bool fresh) noexcept;
+	// puts the journal's entries for a day, which the store has not seen yet, on top of the records read from it.
+	// returns what they change the day's totals by, empty when they change nothing
+	Sharded_counters::Totals overlay_pending(const std::string & day, QList<Record> & records) const noexcept;
+	// the live day's totals from the store with the journal's pending entries on top, as deliver_daily_view adds them
+	void emit_live_totals() noexcept;
+
+	// reads the days around a shown one into adjacent_days_, so stepping to them paints at once
+	void prefetch_adjacent_days(const std::string & day) noexcept;
+
+	struct User_records_page {
+		QVariantMap response;
+		QList<Record> records;
+		firebase::firestore::DocumentSnapshot cursor;
+		bool has_more = false;
+	};
+
+	// months reads the page from the customer's month buckets rather than the records themselves
+	static User_records_page user_records_page(const firebase::Future<firebase::firestore::QuerySnapshot> & future, bool months, const QString & name) noexcept;
+
+	constexpr static size_t user_history_page_size(const bool months) noexcept {
+		return months ? USER_MONTHS_PAGE_SIZE : USER_RECORDS_PAGE_SIZE;
+	}
+
+	struct User_view {
+		bool error = false;
+		QVariantMap metadata;
+		firebase::firestore::Query query;
+		bool months = false;
+		// records from before the day field that were not backfilled yet, an ordered query would skip them.
+		// the whole history is read and sorted here instead
+		bool whole = false;
+		// unset when the customer does not exist or could not be read
+		std::optional<User_records_page> page;
+
+		QVariant fingerprint() const noexcept;
+	};
+
+	// the history is read alongside the customer in the layout months guesses. a wrong guess is read again
+	// in the layout the customer names
+	void read_user_view(const firebase::firestore::DocumentReference & user_doc, firebase::firestore::Source source, bool months,
+		std::function<void(const User_view &)> callback) noexcept;
+	static firebase::firestore::Query user_history_query(const firebase::firestore::DocumentReference & user_doc, bool months) noexcept;
+	void deliver_user_view(const QString & normalized_name, const User_view & view, bool fresh) noexcept;
+	void load_user_records_page(const firebase::firestore::Query & query, bool months, const QString & name, int generation, const Latency_tracer::Span & span) noexcept;
+	// rebuilds one customer's buckets and marks them complete, starting over when a sale of theirs landed meanwhile
+	void backfill_user_buckets(const firebase::firestore::DocumentSnapshot & user, std::function<void(bool failed, int months)> done,
+		int attempt = 1) noexcept;
+	void backfill_record_days_page(const firebase::firestore::Query & ordered, const firebase::firestore::Query & page, int updated) noexcept;
+	void mark_days_complete(int updated) noexcept;
 
+	struct Export_state;
+	struct Import_state;
+	struct Analytics_load;
+
+	void export_records_page(const std::shared_ptr<Export_state> & state) noexcept;
+	void finish_export(const std::shared_ptr<Export_state> & state, bool error) noexcept;
+
+	void import_chunks(const std::shared_ptr<Import_state> & state) noexcept;
+	// added are the records of the chunk that were not in the store yet, the rest were skipped
+	void on_import_chunk_committed(const std::shared_ptr<Import_state> & state, const QList<Record> & records, const QList<Record> & added, bool committed) noexcept;
+
+	void load_analytics_days(const std::shared_ptr<Analytics_load> & load) noexcept;
+	void on_analytics_day(const std::shared_ptr<Analytics_load> & load, const QList<Record> & records, bool error) noexcept;
+
+	void listen_to_users() noexcept;
+	void query_users(const QString & prefix, int limit) noexcept;
+
+	// runs func on the gui thread with whatever else arrived during the same frame
 	template<typename T>
 	void safe_emit(T && func) {
-		QMetaObject::invokeMethod(this, std::forward<T>(func));
+		delivery_.post(std::forward<T>(func));
 	}
 
-	static QString normalize_name(const QString & name) {
-		return name.trimmed().toLower().replace(' ', '_');
+	// the read behind key is done: its delivery fans out to the requests that joined it and stays cached for the ttl
+	template<typename T>
+	void finish_read(const QString & key, const Latency_tracer::Span & span, const bool cacheable, T && func) {
+		traced_emit(span, [this, key, cacheable, func = std::forward<T>(func)]() {
+			reads_.finish(key, func, cacheable);
+		});
 	}
 
-	static std::string normalize_date(const QString & date) {
-		const QStringList parts = date.split('-');
-		return (parts[2] + parts[1].rightJustified(2, '0') + parts[0].rightJustified(2, '0')).toStdString();
+	// a read answered from firestore's local cache first and then from the server. the server's answer
+	// only reaches the caller when it differs from what was painted, or when nothing was
+	struct Revalidation {
+		std::mutex mutex;
+		bool revalidated = false;
+		std::optional<QVariant> painted;
+	};
+
+	template<typename T>
+	void paint_cached(const std::shared_ptr<Revalidation> & revalidation, const QVariant & fingerprint, T && func) {
+
+		if(!cached_paints_) {
+			return;
+		}
+
+		// posted under the lock so a paint never lands after the server's answer
+		std::lock_guard lock(revalidation->mutex);
+
+		if(revalidation->revalidated) {
+			return;
+		}
+
+		revalidation->painted = fingerprint;
+		safe_emit(std::forward<T>(func));
 	}
 
+	// finish_read for the server half. a failed revalidation keeps what was painted
+	template<typename T>
+	void finish_revalidated(const std::shared_ptr<Revalidation> & revalidation, const QString & key, const Latency_tracer::Span & span,
+		const bool ok, const QVariant & fingerprint, T && func) {
+		std::lock_guard lock(revalidation->mutex);
+		revalidation->revalidated = true;
+
+		const bool answered = revalidation->painted && (!ok || *revalidation->painted == fingerprint);
+
+		traced_emit(span, [this, key, ok, answered, func = std::forward<T>(func)]() {
+			reads_.finish(key, func, ok, answered);
+		});
+	}
+
+	// keys of the cached reads a change to that date and customer makes stale
+	void invalidate_reads(const QString & date, const QString & name) noexcept;
+
+	// safe_emit for the last response of a traced operation, timing the hop and the qml handlers
+	template<typename T>
+	void traced_emit(const Latency_tracer::Span & span, T && func) {
+		span.mark(Latency_tracer::Decoded);
+
+		delivery_.post([span, func = std::forward<T>(func)]() mutable {
+			span.mark(Latency_tracer::Emitted);
+			func();
+			span.mark(Latency_tracer::Handled);
+			span.finish();
+		});
+	}
+
+	constexpr static size_t MAX_BATCH_WRITES = 500;
+	constexpr static size_t USER_RECORDS_PAGE_SIZE = 50;
+	constexpr static size_t USER_MONTHS_PAGE_SIZE = 12;
+	constexpr static size_t EXPORT_PAGE_SIZE = 500;
+	constexpr static int IMPORT_BATCHES_IN_FLIGHT = 8;
+	constexpr static int BACKFILL_USER_ATTEMPTS = 5;
+	constexpr static int ANALYTICS_DAYS_IN_FLIGHT = 16;
+	constexpr static float DEFAULT_RATE_WIDTH = 5;
+
+	// a record touches at most 8 documents (daily, monthly, yearly, user, user month, stock and both record copies)
+	constexpr static size_t WRITES_PER_RECORD = 8;
+	constexpr static size_t MAX_COALESCED_ENTRIES = MAX_BATCH_WRITES / WRITES_PER_RECORD;
+	constexpr static int COALESCE_WINDOW_MS = 250;
+	constexpr static int DEFAULT_READ_TTL_MS = 10000;
+	constexpr static int DEFAULT_LOCAL_CACHE_MB = 100;
+	inline static const std::string DEFAULT_WAREHOUSE = "main";
+	constexpr static int DEFAULT_PREFETCH_DAYS = 2;
+	constexpr static int MAX_PREFETCH_DAYS = 15;
+	constexpr static size_t ADJACENT_DAYS_CACHED = 32;
+
+	inline static const std::vector<std::string> TOTAL_FIELDS = {"totalBaleSold", "totalWeightSold", "totalAmount", "totalReceivedAmount"};
+	inline static const std::vector<std::string> STOCK_FIELDS = {"baleAmount", "baleWeight"};
+
 	// removed for github mirror
 	constexpr static std::string_view API_KEY = "";
 	constexpr static std::string_view PROJECT_ID = "";
 	constexpr static std::string_view APP_ID = "";
 
+	// the current site, and every site known from the warehouses collection. gui thread only
+	std::string warehouse_;
+	std::vector<std::string> warehouses_;
+	// read_all_sites waits for the warehouses collection, a sum over the sites known so far would come up short.
+	// a waiter is told whether the list loaded
+	bool warehouses_loaded_ = false;
+	bool warehouses_loading_ = false;
+	std::vector<std::function<void(bool)>> warehouse_waiters_;
+
 	std::unique_ptr<firebase::App> app_;
 	std::unique_ptr<firebase::firestore::Firestore> db_;
+	std::shared_future<void> db_ready_;
+	bool started_ = false;
+
+	// YYYYMMDD of the day the app opened on and the main window's first reads of it
+	std::string startup_day_;
+	Pending_read<Sharded_counters::Result> startup_stock_;
+	Pending_read<Sharded_counters::Result> startup_daily_totals_;
+	Pending_read<firebase::Future<firebase::firestore::QuerySnapshot>> startup_daily_records_;
+
+	firebase::firestore::Query user_records_query_;
+	firebase::firestore::DocumentSnapshot user_records_cursor_;
+	bool user_records_months_ = false;
+	QString user_records_display_name_;
+	QString user_records_name_;
+	int user_records_generation_ = 0;
+	bool user_records_has_more_ = false;
+	bool user_records_loading_ = false;
+
+	Customer_index customer_index_;
+	firebase::firestore::ListenerRegistration users_listener_;
+
+	bool live_updates_ = false;
+	// read from the sdk threads
+	std::atomic<bool> cached_paints_{true};
+	int daily_subscription_generation_ = 0;
+	std::vector<firebase::firestore::ListenerRegistration> daily_totals_listeners_;
+	firebase::firestore::ListenerRegistration daily_records_listener_;
+	// what the listeners last heard from the store for the live day, the totals once they came
+	std::string live_day_;
+	std::optional<QVariantMap> live_totals_;
+	QList<Record> live_stored_;
+	std::vector<firebase::firestore::ListenerRegistration> stock_listeners_;
+
+	// shards per counter, 1 keeps the counter in its base document
+	Counter_shards counter_shards_;
+	Delivery_queue delivery_;
+	Read_cache reads_;
+
+	// YYYYMMDD -> the day as last read from the server, painted while stepping through dates. gui thread only
+	Lru_cache<std::string, Daily_view> adjacent_days_{ADJACENT_DAYS_CACHED};
+	std::unordered_set<std::string> prefetching_days_;
+	// bumped by every write, so a prefetch that raced one is dropped
+	int prefetch_generation_ = 0;
+	int prefetch_days_ = DEFAULT_PREFETCH_DAYS;
+
+	Range_index range_index_;
+
+	Analytics_store analytics_;
+	// bumped by every load, so days of a replaced load are dropped
+	int analytics_generation_ = 0;
+	bool range_index_loading_ = false;
+	std::vector<std::pair<QString, QString>> pending_range_queries_;
+
+	Latency_tracer tracer_;
+	Journal journal_;
+	QTimer replay_window_;
+	bool replay_in_flight_ = false;
+	int replay_retry_ms_ = 0;
+	// entries still to replay one at a time, after a batch failed for good and the culprit is not known yet
+	size_t replay_isolating_ = 0;
+	int last_replay_latency_ms_ = -1;
 };
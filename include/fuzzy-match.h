@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// edit distances against one pattern, one 64 bit word per text character (myers' bit-parallel algorithm).
+// patterns longer than 64 characters are cut to their first 64
+class Fuzzy_pattern {
+public:
+	explicit Fuzzy_pattern(const QString & pattern) noexcept;
+
+	int length() const noexcept { return length_; }
+
+	// levenshtein distance between the pattern and the whole text
+	int distance(const QString & text) const noexcept;
+
+	// fewest edits turning the pattern into some substring of text, so a partly typed name still scores 0
+	int substring_distance(const QString & text) const noexcept;
+
+	constexpr static int MAX_LENGTH = 64;
+
+private:
+	uint64_t peq(char16_t c) const noexcept;
+	int run(const QString & text, bool anchored) const noexcept;
+
+	int length_ = 0;
+	std::array<uint64_t, 128> ascii_{};
+	std::vector<std::pair<char16_t, uint64_t>> other_;
+};
+
+// dice coefficient of the two strings' character trigrams, 1 when they are made of the same ones
+double trigram_similarity(const QString & a, const QString & b) noexcept;
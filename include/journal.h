@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QFile>
+#include <QByteArray>
+#include <QList>
+#include <QLockFile>
+#include <QString>
+#include <QVariantMap>
+
+#include <deque>
+
+// append-only log of mutations that have been acknowledged to the ui but not yet committed to firestore.
+// one json object per line; a line is fsync'd before append() returns
+class Journal {
+public:
+	struct Entry {
+		qint64 seq = 0;
+		qint64 created_ms = 0;
+		QString op;
+		// idempotency key, the pre-generated daily record docID
+		QString key;
+		QVariantMap data;
+	};
+
+	explicit Journal(QString path) noexcept;
+
+	// loads the entries left pending by a previous run and compacts the file. fails while another
+	// process has it open
+	bool open() noexcept;
+
+	// another process has the journal open. both replaying the same file would commit its entries twice
+	bool busy() const noexcept { return lock_.error() == QLockFile::LockFailedError; }
+
+	bool append(const QString & op, const QString & key, const QVariantMap & data) noexcept;
+
+	// marks the entries committed with a single flush
+	bool complete(const QList<qint64> & seqs) noexcept;
+
+	// takes entries the store refused for good out of the replay queue. they are kept, with the reason,
+	// in a .rejected.ndjson file beside the journal
+	bool reject(const QList<qint64> & seqs, const QString & reason) noexcept;
+
+	const std::deque<Entry> & pending() const noexcept { return pending_; }
+	int depth() const noexcept { return static_cast<int>(pending_.size()); }
+
+private:
+	bool write(const QByteArray & bytes) noexcept;
+
+	QString path_;
+	QLockFile lock_;
+	QFile file_;
+	std::deque<Entry> pending_;
+	qint64 next_seq_ = 1;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// log-linear buckets in the style of HdrHistogram: 16 sub-buckets per power of two,
+// so any recorded value is off by at most 1/16th. values are microseconds
+class Latency_histogram {
+public:
+	void record(int64_t value_us) noexcept;
+
+	int64_t count() const noexcept { return count_; }
+	int64_t max() const noexcept { return max_; }
+
+	// upper edge of the bucket holding the p-th quantile, p in [0, 1]
+	int64_t percentile(double p) const noexcept;
+
+private:
+	constexpr static int SUB_BUCKET_BITS = 4;
+	constexpr static int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	// enough powers of two for about nine and a half hours
+	constexpr static int MAGNITUDES = 32;
+
+	static int bucket_of(int64_t value_us) noexcept;
+	static int64_t upper_edge(int bucket) noexcept;
+
+	std::array<int64_t, SUB_BUCKETS * MAGNITUDES> buckets_{};
+	int64_t count_ = 0;
+	int64_t max_ = 0;
+};
+
+// times each backend operation through its stages and keeps a histogram per operation and phase.
+// spans are started on the gui thread, marked from whichever thread the sdk calls back on
+class Latency_tracer : public QObject {
+	Q_OBJECT
+public:
+	enum Stage {
+		Issued,
+		Completed,
+		Decoded,
+		Emitted,
+		Handled,
+		STAGE_COUNT
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	class Span {
+	public:
+		Span() noexcept = default;
+
+		// a later mark of the same stage wins, a skipped stage takes the time of the one before it
+		void mark(Stage stage) const noexcept;
+
+		// records the span; only the first call counts
+		void finish() const noexcept;
+
+	private:
+		friend class Latency_tracer;
+
+		struct Data {
+			QString op;
+			int64_t id = 0;
+			std::array<Clock::time_point, STAGE_COUNT> at{};
+			std::array<bool, STAGE_COUNT> marked{};
+			bool finished = false;
+			std::mutex mutex;
+		};
+
+		Latency_tracer * tracer_ = nullptr;
+		std::shared_ptr<Data> data_;
+	};
+
+	explicit Latency_tracer(QObject * parent = nullptr) noexcept;
+
+	Span start(const QString & op) noexcept;
+
+	// one row per operation: count and total p50/p99/max, then p99 of each phase, all in ms
+	Q_INVOKABLE QVariantList summary() const noexcept;
+
+	// writes the recent spans as a chrome trace (chrome://tracing, perfetto), rotating the older dumps
+	Q_INVOKABLE QString dump() const noexcept;
+
+	Q_INVOKABLE void reset() noexcept;
+
+private:
+	// issued->completed is the firestore round trip, then the sdk callback, the hop to the gui thread and qml
+	enum Phase {
+		Total,
+		Store,
+		Callback,
+		Queue,
+		Handler,
+		PHASE_COUNT
+	};
+
+	struct Finished_span {
+		QString op;
+		int64_t id = 0;
+		std::array<int64_t, STAGE_COUNT> at_us{};
+	};
+
+	void record(const Span::Data & data) noexcept;
+
+	constexpr static size_t MAX_KEPT_SPANS = 20000;
+	constexpr static int KEPT_DUMPS = 5;
+
+	const Clock::time_point epoch_ = Clock::now();
+
+	mutable std::mutex mutex_;
+	int64_t next_id_ = 1;
+	std::map<QString, std::array<Latency_histogram, PHASE_COUNT>> histograms_;
+	std::deque<Finished_span> spans_;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include "record-list-model.h"
+
+// what the ui and the load generator talk to. every call answers through the matching *Response signal,
+// with the response maps shaped the same whichever store is behind it
+class Ledger_backend : public QObject {
+	Q_OBJECT
+	Q_PROPERTY(Record_list_model * dailyRecords READ daily_records CONSTANT)
+	Q_PROPERTY(Record_list_model * userRecords READ user_records CONSTANT)
+public:
+	explicit Ledger_backend(QObject * parent = nullptr) noexcept : QObject(parent) {}
+
+	Record_list_model * daily_records() noexcept { return &daily_records_; }
+	Record_list_model * user_records() noexcept { return &user_records_; }
+
+	Q_INVOKABLE virtual void get_bale() noexcept = 0;
+	Q_INVOKABLE virtual void set_bale(int bale_amount, int bale_weight) noexcept = 0;
+
+	// the response echoes data, so callers can tag a request with keys of their own
+	Q_INVOKABLE virtual void add_record(const QVariantMap & data) noexcept = 0;
+	Q_INVOKABLE virtual void delete_record(const QVariantMap & data) noexcept = 0;
+
+	Q_INVOKABLE virtual void get_daily_records(const QString & date) noexcept = 0;
+	Q_INVOKABLE virtual void get_user_records(const QString & name) noexcept = 0;
+
+	Q_INVOKABLE virtual void get_users(const QString & prefix, int limit = 10) noexcept = 0;
+	Q_INVOKABLE virtual void get_monthly_totals(int month, int year) noexcept = 0;
+
+signals:
+	void setBaleResponse(const QVariantMap & response);
+	void getBaleResponse(const QVariantMap & response);
+
+	void addRecordResponse(const QVariantMap & response);
+	void deleteRecordResponse(const QVariantMap & response);
+
+	void getDailyRecordsResponseMetadata(const QVariantMap & response);
+	void getDailyRecordsResponse(const QVariantMap & response);
+
+	void getUserRecordsResponseMetadata(const QVariantMap & response);
+	void getUserRecordsResponse(const QVariantMap & response);
+
+	void getUsersResponse(const QVariantMap & response);
+	void getMonthlyTotalsResponse(const QVariantMap & response);
+
+protected:
+	Record_list_model daily_records_;
+	Record_list_model user_records_;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// keeps the most recently used entries up to a fixed count, dropping the least recently used one to make room
+template<typename Key, typename Value>
+class Lru_cache {
+public:
+	explicit Lru_cache(const size_t capacity) noexcept : capacity_(capacity) {}
+
+	size_t size() const noexcept { return index_.size(); }
+
+	bool contains(const Key & key) const noexcept {
+		return index_.count(key) != 0;
+	}
+
+	// counts as a use, the pointer is valid until the next put or erase
+	const Value * find(const Key & key) noexcept {
+		const auto it = index_.find(key);
+
+		if(it == index_.end()) {
+			return nullptr;
+		}
+
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return &it->second->second;
+	}
+
+	void put(const Key & key, Value value) noexcept {
+
+		if(const auto it = index_.find(key); it != index_.end()) {
+			it->second->second = std::move(value);
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return;
+		}
+
+		entries_.emplace_front(key, std::move(value));
+		index_[key] = entries_.begin();
+
+		if(entries_.size() > capacity_) {
+			index_.erase(entries_.back().first);
+			entries_.pop_back();
+		}
+	}
+
+	void erase(const Key & key) noexcept {
+
+		if(const auto it = index_.find(key); it != index_.end()) {
+			entries_.erase(it->second);
+			index_.erase(it);
+		}
+	}
+
+	void clear() noexcept {
+		entries_.clear();
+		index_.clear();
+	}
+
+private:
+	size_t capacity_ = 0;
+	// most recently used first
+	std::list<std::pair<Key, Value>> entries_;
+	std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator> index_;
+};
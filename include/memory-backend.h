@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QRandomGenerator>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "ledger-backend.h"
+#include "record.h"
+
+// keeps the whole ledger in process, for load tests and for reproducing slow responses without a firestore project.
+// a mutation is applied when its response is delivered, after latency_ms plus up to jitter_ms
+class Memory_backend : public Ledger_backend {
+	Q_OBJECT
+public:
+	explicit Memory_backend(QObject * parent = nullptr) noexcept;
+
+	void set_latency(int latency_ms, int jitter_ms) noexcept;
+
+	void get_bale() noexcept override;
+	void set_bale(int bale_amount, int bale_weight) noexcept override;
+
+	void add_record(const QVariantMap & data) noexcept override;
+	void delete_record(const QVariantMap & data) noexcept override;
+
+	void get_daily_records(const QString & date) noexcept override;
+	void get_user_records(const QString & name) noexcept override;
+
+	void get_users(const QString & prefix, int limit = 10) noexcept override;
+	void get_monthly_totals(int month, int year) noexcept override;
+
+private:
+	struct Totals {
+		int64_t bale_sold = 0;
+		int64_t weight_sold = 0;
+		int64_t amount = 0;
+		int64_t received_amount = 0;
+
+		void add(const Record & record, int sign) noexcept;
+		QVariantMap to_variant_map() const noexcept;
+	};
+
+	struct Day {
+		Totals totals;
+		std::map<QString, Record> records;
+	};
+
+	struct User {
+		QString name;
+		QString phone;
+		Totals totals;
+		int64_t debt = 0;
+		QSet<QString> doc_ids;
+	};
+
+	// runs func once the injected latency has passed
+	template<typename T>
+	void respond(T && func) noexcept;
+
+	int latency_ms_ = 0;
+	int jitter_ms_ = 0;
+	QRandomGenerator random_;
+
+	std::map<std::string, Day> days_;
+	std::map<QString, User> users_;
+	int64_t bale_amount_ = 0;
+	int64_t bale_weight_ = 0;
+	int64_t next_doc_id_ = 1;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QDate>
+#include <QString>
+#include <QStringList>
+
+#include <string>
+
+// document id of a customer under "users"
+inline QString normalize_name(const QString & name) {
+	return name.trimmed().toLower().replace(' ', '_');
+}
+
+// whether a date is DD-MM-YYYY, or D-M-YYYY, and names a day that exists
+inline bool valid_date(const QString & date) {
+	return date.split('-').size() == 3 && QDate::fromString(date, "d-M-yyyy").isValid();
+}
+
+// DD-MM-YYYY to the YYYYMMDD document id under "daily_record", empty for anything else
+inline std::string normalize_date(const QString & date) {
+	const QStringList parts = date.split('-');
+
+	if(parts.size() != 3) {
+		return {};
+	}
+
+	return (parts[2] + parts[1].rightJustified(2, '0') + parts[0].rightJustified(2, '0')).toStdString();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// a read started before anyone asked for it. the first request to claim it gets the result, whether it
+// arrives before or after the claim; later requests read for themselves
+template<typename T>
+class Pending_read {
+public:
+	using Consumer = std::function<void(const T &)>;
+
+	void start() noexcept {
+		std::lock_guard lock(mutex_);
+		started_ = true;
+	}
+
+	// may run on any thread, the consumer runs on it when the claim came first
+	void set(T value) noexcept {
+		Consumer consumer;
+
+		{
+			std::lock_guard lock(mutex_);
+
+			if(!consumer_) {
+				value_ = std::move(value);
+				return;
+			}
+
+			consumer = std::move(consumer_);
+		}
+
+		consumer(value);
+	}
+
+	// false when nothing was started or it was already claimed
+	bool claim(Consumer consumer) noexcept {
+		std::optional<T> value;
+
+		{
+			std::lock_guard lock(mutex_);
+
+			if(!started_) {
+				return false;
+			}
+
+			started_ = false;
+
+			if(!value_) {
+				consumer_ = std::move(consumer);
+				return true;
+			}
+
+			value = std::move(value_);
+			value_.reset();
+		}
+
+		consumer(*value);
+		return true;
+	}
+
+private:
+	std::mutex mutex_;
+	bool started_ = false;
+	std::optional<T> value_;
+	Consumer consumer_;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// daily totals in fenwick trees keyed by day ordinal, so the totals of any range of days
+// are two prefix sums away. days are the YYYYMMDD document ids under "daily_record"
+class Range_index {
+public:
+	struct Totals {
+		int64_t bale_sold = 0;
+		int64_t weight_sold = 0;
+		int64_t amount = 0;
+		int64_t received_amount = 0;
+
+		Totals & operator+=(const Totals & other) noexcept;
+		Totals & operator-=(const Totals & other) noexcept;
+	};
+
+	bool loaded() const noexcept { return loaded_; }
+
+	void reset(const std::map<std::string, Totals> & days) noexcept;
+	void add(const std::string & day, const Totals & delta) noexcept;
+
+	// both ends inclusive
+	Totals sum(const std::string & from, const std::string & to) const noexcept;
+
+	// -1 for anything that is not a valid YYYYMMDD
+	static int64_t ordinal(const std::string & day) noexcept;
+
+private:
+	Totals prefix(int64_t ordinal) const noexcept;
+	void rebuild(int64_t first, int64_t size) noexcept;
+
+	// ordinal of slot 0 and the per-day values the trees are rebuilt from when the span grows
+	int64_t first_ = 0;
+	std::vector<Totals> values_;
+	std::vector<Totals> tree_;
+	bool loaded_ = false;
+};
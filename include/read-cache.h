@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include <functional>
+
+// coalesces identical reads and keeps their results for a while. a result is kept as the closure that
+// delivers it (emits the signals, fills the models), so a hit replays exactly what the read did.
+// gui thread only
+class Read_cache {
+public:
+	using Apply = std::function<void()>;
+
+	explicit Read_cache(QObject * owner, int ttl_ms) noexcept;
+
+	int ttl() const noexcept { return ttl_ms_; }
+	void set_ttl(int ttl_ms) noexcept;
+
+	// true when the caller should issue the read and hand its result to finish(). otherwise the result
+	// arrives from the cache (queued, never before join returns) or from the identical read in flight
+	bool join(const QString & key) noexcept;
+
+	// delivers once for the caller and every request that joined it, the signals reach them all alike,
+	// then caches unless it failed or the key was invalidated while the read was in flight. caller_answered
+	// skips the delivery when only the caller waits and already has an equal answer
+	void finish(const QString & key, const Apply & apply, bool cacheable, bool caller_answered = false) noexcept;
+
+	void invalidate(const QString & key) noexcept;
+	void clear() noexcept;
+
+private:
+	struct Entry {
+		int waiters = 0;
+		bool in_flight = false;
+		bool stale = false;
+		Apply cached;
+		QDeadlineTimer expires;
+	};
+
+	QObject * owner_ = nullptr;
+	int ttl_ms_ = 0;
+	QHash<QString, Entry> entries_;
+};
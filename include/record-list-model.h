@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+
+#include "record.h"
+
+class Record_list_model : public QAbstractListModel {
+	Q_OBJECT
+	Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+	enum Role {
+		DocIdRole = Qt::UserRole + 1,
+		DateRole,
+		NameRole,
+		BaleSoldRole,
+		WeightSoldRole,
+		RateRole,
+		AmountRole,
+		ReceivedAmountRole
+	};
+
+	explicit Record_list_model(QObject * parent = nullptr) noexcept;
+
+	int rowCount(const QModelIndex & parent = {}) const override;
+	QVariant data(const QModelIndex & index, int role) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+	int count() const noexcept { return static_cast<int>(records_.size()); }
+	const QList<Record> & records() const noexcept { return records_; }
+
+	// replaces the contents with a single insertion
+	void set_records(const QList<Record> & records) noexcept;
+	void append_records(const QList<Record> & records) noexcept;
+
+	Q_INVOKABLE void clear() noexcept;
+
+	// inserts the record or updates the existing row with the same docID
+	Q_INVOKABLE void add_record(const QVariantMap & data) noexcept;
+	void add_record(const Record & record) noexcept;
+	// keeps the order of the rows around it, the ones after it are reindexed
+	Q_INVOKABLE bool remove_record(const QString & doc_id) noexcept;
+
+signals:
+	void countChanged();
+
+private:
+	QList<Record> records_;
+	QHash<QString, int> rows_;
+};
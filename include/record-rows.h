@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+
+#include "record.h"
+
+// one record per line for export and import: csv with a header row, or ndjson with the record's qml keys
+class Record_rows {
+public:
+	enum class Format {
+		Csv,
+		Ndjson
+	};
+
+	struct Row {
+		Record record;
+		QString phone;
+	};
+
+	// csv for *.csv, ndjson for anything else
+	static Format format_of(const QString & path) noexcept;
+
+	static QByteArray header(Format format) noexcept;
+	static QByteArray encode(const Record & record, Format format) noexcept;
+
+	explicit Record_rows(QIODevice * device, Format format) noexcept;
+
+	// false at the end of the input. a row that fails validation still returns true, with error set
+	bool next(Row & row, QString & error) noexcept;
+
+	// 1-based line of the row next() returned last
+	qint64 line() const noexcept { return line_; }
+
+private:
+	static QStringList split_csv(const QByteArray & line) noexcept;
+	static QString validate(const Row & row) noexcept;
+
+	QIODevice * device_ = nullptr;
+	Format format_ = Format::Csv;
+	QHash<QString, int> columns_;
+	qint64 line_ = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "normalize.h"
+
+#include <QString>
+#include <QVariantMap>
+
+#include <cmath>
+#include <string>
+
+struct Record {
+	QString doc_id;
+	QString date;
+	QString name;
+	int bale_sold = 0;
+	int weight_sold = 0;
+	float rate = 0;
+	int amount = 0;
+	int received_amount = 0;
+
+	static Record from_variant_map(const QVariantMap & data) noexcept {
+		Record record;
+
+		record.doc_id = data["docID"].toString();
+		record.date = data["date"].toString();
+		record.name = data["name"].toString();
+		record.bale_sold = data["baleSold"].toInt();
+		record.weight_sold = data["weightSold"].toInt();
+		record.rate = data["rate"].toFloat();
+		record.amount = data["amount"].toInt();
+		record.received_amount = data["receivedAmount"].toInt();
+
+		return record;
+	}
+
+	// what keeps a record from being stored, empty when nothing does
+	static QString invalid_fields(const QVariantMap & data) noexcept {
+
+		if(!valid_date(data["date"].toString())) {
+			return "date must be DD-MM-YYYY";
+		}
+
+		if(data["name"].toString().trimmed().isEmpty()) {
+			return "name must be a non-empty string";
+		}
+
+		for(const auto * field : {"baleSold", "weightSold", "rate", "amount", "receivedAmount"}) {
+			const auto & value = data[field];
+			bool ok = false;
+			const auto number = value.toDouble(&ok);
+
+			// text that happens to hold a number is still text
+			if(!ok || !std::isfinite(number) || value.typeId() == QMetaType::QString) {
+				return QString(field) + " must be a number";
+			}
+		}
+
+		return {};
+	}
+
+	QVariantMap to_variant_map() const noexcept {
+		return {
+			{"docID", doc_id},
+			{"date", date},
+			{"name", name},
+			{"baleSold", bale_sold},
+			{"weightSold", weight_sold},
+			{"rate", rate},
+			{"amount", amount},
+			{"receivedAmount", received_amount}
+		};
+	}
+};
+
+// decodes a firestore record document (or anything exposing Get(field) -> FieldValue)
+template<typename Doc>
+Record decode_record(const Doc & doc, const std::string & doc_id) noexcept {
+	Record record;
+
+	record.doc_id = QString::fromStdString(doc_id);
+	record.date = QString::fromStdString(doc.Get("date").string_value());
+	record.name = QString::fromStdString(doc.Get("name").string_value());
+	record.bale_sold = static_cast<int>(doc.Get("baleSold").integer_value());
+	record.weight_sold = static_cast<int>(doc.Get("weightSold").integer_value());
+	record.rate = static_cast<float>(doc.Get("rate").double_value());
+	record.amount = static_cast<int>(doc.Get("amount").integer_value());
+	record.received_amount = static_cast<int>(doc.Get("receivedAmount").integer_value());
+
+	return record;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+
+class Firebase;
+class QLocalSocket;
+
+// the backend's calls as json-rpc 2.0 over a local socket, one request or response per line. a connection
+// may send any number of requests without waiting, the answers come back as each call finishes and carry
+// the request's id. calls whose responses tell them apart run concurrently, the rest one at a time
+class Rpc_server : public QObject {
+	Q_OBJECT
+public:
+	explicit Rpc_server(Firebase * firebase, QObject * parent = nullptr) noexcept;
+
+	// false when the name is taken by a server that is still running
+	bool listen(const QString & name) noexcept;
+	QString full_name() const noexcept { return server_.fullServerName(); }
+
+private:
+	using Call = std::function<void(Firebase &, const QVariantList &)>;
+	using Finish = std::function<QVariantMap(Firebase &, QVariantMap)>;
+	using Check = std::function<QString(const QVariantList &)>;
+
+	struct Method {
+		QStringList params;
+		// the signal that answers the call. calls that send metadata first name it here and the rest in then,
+		// which only follows metadata that is neither an error nor empty
+		QByteArray response;
+		void (Firebase::*signal)(const QVariantMap &) = nullptr;
+		QByteArray then;
+		void (Firebase::*then_signal)(const QVariantMap &) = nullptr;
+		// response fields that name the call they answer, each a param or a field of a map param.
+		// empty when nothing does, and then calls answered by the same signal run one after another
+		QStringList keys;
+		Call call;
+		// the result from the response, for calls that leave their records in a model
+		Finish finish;
+		// what is wrong with the params, empty when nothing is. the backend indexes dates and fields blindly
+		Check check;
+	};
+
+	struct Pending {
+		QPointer<QLocalSocket> socket;
+		QJsonValue id;
+		const Method * method = nullptr;
+		QVariantList args;
+		QVariantMap expected;
+		// the metadata, once it came and the rest is awaited
+		std::optional<QVariantMap> metadata;
+	};
+
+	void add_method(const QString & name, Method method) noexcept;
+
+	void on_connection() noexcept;
+	void on_readable(QLocalSocket * socket) noexcept;
+	void on_request(QLocalSocket * socket, const QByteArray & line) noexcept;
+	void on_response(const QByteArray & signal, const QVariantMap & response) noexcept;
+	void on_then(const QByteArray & signal, const QVariantMap & response) noexcept;
+
+	// runs the unkeyed calls of a signal whose turn has come
+	void advance(const QByteArray & signal) noexcept;
+	void answer(const Pending & pending, QVariantMap result) noexcept;
+
+	static void write(QLocalSocket * socket, const QJsonObject & message) noexcept;
+	static void reply_error(QLocalSocket * socket, const QJsonValue & id, int code, const QString & message) noexcept;
+
+	// json-rpc's own error codes
+	constexpr static int PARSE_ERROR = -32700;
+	constexpr static int INVALID_REQUEST = -32600;
+	constexpr static int METHOD_NOT_FOUND = -32601;
+	constexpr static int INVALID_PARAMS = -32602;
+
+	// a line longer than this is not a request, the connection is dropped
+	constexpr static qint64 MAX_LINE_BYTES = 16 * 1024 * 1024;
+
+	// added to a written record and echoed back in its response
+	inline static const QString TAG_FIELD = "rpcTag";
+
+	Firebase * firebase_ = nullptr;
+	QLocalServer server_;
+	// node based, pending calls point into it
+	std::map<QString, Method> methods_;
+	QSet<QByteArray> connected_;
+	// then signal -> the first signal of its calls
+	QHash<QByteArray, QByteArray> firsts_;
+
+	// per answering signal, the calls it still owes in the order they were made, and the unkeyed
+	// calls waiting for the one ahead of them. a call waiting on its then signal stays under the first
+	QHash<QByteArray, std::deque<Pending>> in_flight_;
+	QHash<QByteArray, std::deque<Pending>> queued_;
+	QSet<QByteArray> advancing_;
+
+	qint64 next_tag_ = 0;
+};
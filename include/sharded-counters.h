@@ -0,0 +1,41 @@
+#pragma once
+
+#include <firebase/firestore.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// counter documents whose increments can be spread over up to MAX_SHARDS documents in their "shards"
+// subcollection. the base document keeps whatever it held before sharding was turned on and readers
+// always sum it with the shards, so switching a counter between layouts needs no data to be moved
+class Sharded_counters {
+public:
+	using Totals = std::map<std::string, int64_t>;
+
+	struct Result {
+		bool error = false;
+		bool exists = false;
+		Totals totals;
+	};
+
+	using Callback = std::function<void(const Result &)>;
+
+	constexpr static int MAX_SHARDS = 16;
+
+	// the document a write should increment, the base itself when the counter is not sharded
+	static firebase::firestore::DocumentReference shard(const firebase::firestore::DocumentReference & counter, int shards, uint32_t salt) noexcept;
+
+	static void add_fields(Result & result, const firebase::firestore::DocumentSnapshot & doc, const std::vector<std::string> & fields) noexcept;
+
+	// the base and its shards are read concurrently; the callback runs on whichever thread finishes last.
+	// from the local cache a base document it never saw is an error
+	static void read(const firebase::firestore::DocumentReference & counter, const std::vector<std::string> & fields, Callback callback,
+		firebase::firestore::Source source = firebase::firestore::Source::kDefault) noexcept;
+
+	// live sum of the base and its shards, reported once both listeners have delivered a snapshot
+	static std::vector<firebase::firestore::ListenerRegistration> listen(const firebase::firestore::DocumentReference & counter,
+		const std::vector<std::string> & fields, Callback callback) noexcept;
+};
@@ -0,0 +1,259 @@
+#include "analytics-store.h"
+#include "normalize.h"
+#include "range-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+void Analytics_store::clear() noexcept {
+	days_.clear();
+	months_.clear();
+	customers_.clear();
+	bale_sold_.clear();
+	weight_sold_.clear();
+	rates_.clear();
+	amounts_.clear();
+	received_amounts_.clear();
+
+	ids_.clear();
+	names_.clear();
+}
+
+void Analytics_store::reserve(const size_t records) noexcept {
+	days_.reserve(records);
+	months_.reserve(records);
+	customers_.reserve(records);
+	bale_sold_.reserve(records);
+	weight_sold_.reserve(records);
+	rates_.reserve(records);
+	amounts_.reserve(records);
+	received_amounts_.reserve(records);
+}
+
+int32_t Analytics_store::month_ordinal(const std::string & day) noexcept {
+	return std::stoi(day.substr(0, 4)) * 12 + std::stoi(day.substr(4, 2)) - 1;
+}
+
+bool Analytics_store::append(const Record & record) noexcept {
+	const auto parts = record.date.split('-');
+
+	if(parts.size() != 3) {
+		return false;
+	}
+
+	const auto day = normalize_date(record.date);
+	const auto ordinal = Range_index::ordinal(day);
+
+	if(ordinal < 0) {
+		return false;
+	}
+
+	const auto key = normalize_name(record.name);
+	auto it = ids_.find(key);
+
+	if(it == ids_.end()) {
+		it = ids_.insert(key, static_cast<uint32_t>(names_.size()));
+		names_.push_back(record.name);
+	}
+
+	days_.push_back(ordinal);
+	months_.push_back(month_ordinal(day));
+	customers_.push_back(*it);
+	bale_sold_.push_back(record.bale_sold);
+	weight_sold_.push_back(record.weight_sold);
+	rates_.push_back(record.rate);
+	amounts_.push_back(record.amount);
+	received_amounts_.push_back(record.received_amount);
+
+	return true;
+}
+
+int32_t Analytics_store::customer_id(const QString & name) const noexcept {
+	const auto it = ids_.find(normalize_name(name));
+	return it == ids_.end() ? -1 : static_cast<int32_t>(*it);
+}
+
+std::vector<uint32_t> Analytics_store::select(const Filter & filter) const noexcept {
+	std::vector<uint32_t> rows(days_.size());
+	size_t selected = 0;
+
+	// every row is written and only the passing ones advance, so the loop has no branch to mispredict
+	if(filter.customer < 0) {
+
+		for(size_t i = 0; i < days_.size(); ++i) {
+			rows[selected] = static_cast<uint32_t>(i);
+			selected += (days_[i] >= filter.from_day) & (days_[i] <= filter.to_day);
+		}
+
+	} else {
+		const auto customer = static_cast<uint32_t>(filter.customer);
+
+		for(size_t i = 0; i < days_.size(); ++i) {
+			rows[selected] = static_cast<uint32_t>(i);
+			selected += (days_[i] >= filter.from_day) & (days_[i] <= filter.to_day) & (customers_[i] == customer);
+		}
+	}
+
+	rows.resize(selected);
+	return rows;
+}
+
+Analytics_store::Keys Analytics_store::keys_of(const std::vector<uint32_t> & rows, const Dimension dimension, const float rate_width) const noexcept {
+	Keys keys;
+	keys.values.resize(rows.size());
+
+	switch(dimension) {
+
+		case Dimension::None:
+			break;
+
+		case Dimension::Customer:
+			keys.cardinality = std::max<uint32_t>(static_cast<uint32_t>(names_.size()), 1);
+
+			for(size_t i = 0; i < rows.size(); ++i) {
+				keys.values[i] = customers_[rows[i]];
+			}
+
+			break;
+
+		case Dimension::Month: {
+			int32_t first = std::numeric_limits<int32_t>::max();
+			int32_t last = std::numeric_limits<int32_t>::min();
+
+			for(const auto row : rows) {
+				first = std::min(first, months_[row]);
+				last = std::max(last, months_[row]);
+			}
+
+			if(rows.empty()) {
+				break;
+			}
+
+			keys.offset = first;
+			keys.cardinality = static_cast<uint32_t>(last - first + 1);
+
+			for(size_t i = 0; i < rows.size(); ++i) {
+				keys.values[i] = static_cast<uint32_t>(months_[rows[i]] - first);
+			}
+
+			break;
+		}
+
+		case Dimension::Rate: {
+			const float width = rate_width > 0 ? rate_width : 1;
+			uint32_t last = 0;
+
+			for(size_t i = 0; i < rows.size(); ++i) {
+				const auto bucket = std::floor(rates_[rows[i]] / width);
+
+				// a nan or negative rate goes in the first bucket, casting it or an infinite one is undefined
+				keys.values[i] = bucket > 0 ? static_cast<uint32_t>(std::min(bucket, static_cast<float>(MAX_RATE_BUCKET))) : 0;
+				last = std::max(last, keys.values[i]);
+			}
+
+			keys.cardinality = last + 1;
+			break;
+		}
+	}
+
+	return keys;
+}
+
+std::vector<Analytics_store::Group> Analytics_store::group_by(const std::vector<uint32_t> & rows, const Dimension first, const Dimension second,
+	const float rate_width) const noexcept {
+
+	const auto first_keys = keys_of(rows, first, rate_width);
+	const auto second_keys = keys_of(rows, second, rate_width);
+	const uint64_t cardinality = uint64_t(first_keys.cardinality) * second_keys.cardinality;
+
+	// each row's group, numbered in order of first appearance
+	std::vector<uint32_t> groups(rows.size());
+	std::vector<uint64_t> group_keys;
+
+	const auto key_of = [&](const size_t i) {
+		return uint64_t(first_keys.values[i]) * second_keys.cardinality + second_keys.values[i];
+	};
+
+	if(cardinality <= DENSE_GROUPS) {
+		std::vector<int32_t> slots(cardinality, -1);
+
+		for(size_t i = 0; i < rows.size(); ++i) {
+			const auto key = key_of(i);
+
+			if(slots[key] < 0) {
+				slots[key] = static_cast<int32_t>(group_keys.size());
+				group_keys.push_back(key);
+			}
+
+			groups[i] = static_cast<uint32_t>(slots[key]);
+		}
+
+	} else {
+		std::unordered_map<uint64_t, uint32_t> slots;
+
+		for(size_t i = 0; i < rows.size(); ++i) {
+			const auto [it, inserted] = slots.try_emplace(key_of(i), static_cast<uint32_t>(group_keys.size()));
+
+			if(inserted) {
+				group_keys.push_back(it->first);
+			}
+
+			groups[i] = it->second;
+		}
+	}
+
+	// one pass per measure column
+	std::vector<int64_t> records(group_keys.size());
+	std::vector<int64_t> bale_sold(group_keys.size());
+	std::vector<int64_t> weight_sold(group_keys.size());
+	std::vector<int64_t> amount(group_keys.size());
+	std::vector<int64_t> received_amount(group_keys.size());
+
+	for(const auto group : groups) {
+		++records[group];
+	}
+
+	sum_into(bale_sold, bale_sold_, rows, groups);
+	sum_into(weight_sold, weight_sold_, rows, groups);
+	sum_into(amount, amounts_, rows, groups);
+	sum_into(received_amount, received_amounts_, rows, groups);
+
+	const auto assign = [](Group & group, const Dimension dimension, const Keys & keys, const uint32_t key) {
+
+		switch(dimension) {
+
+			case Dimension::None:
+				break;
+
+			case Dimension::Customer:
+				group.customer = static_cast<int32_t>(key);
+				break;
+
+			case Dimension::Month:
+				group.month = static_cast<int32_t>(key) + keys.offset;
+				break;
+
+			case Dimension::Rate:
+				group.rate_bucket = static_cast<int32_t>(key);
+				break;
+		}
+	};
+
+	std::vector<Group> result(group_keys.size());
+
+	for(size_t g = 0; g < group_keys.size(); ++g) {
+		auto & group = result[g];
+
+		assign(group, first, first_keys, static_cast<uint32_t>(group_keys[g] / second_keys.cardinality));
+		assign(group, second, second_keys, static_cast<uint32_t>(group_keys[g] % second_keys.cardinality));
+
+		group.records = records[g];
+		group.bale_sold = bale_sold[g];
+		group.weight_sold = weight_sold[g];
+		group.amount = amount[g];
+		group.received_amount = received_amount[g];
+	}
+
+	return result;
+}
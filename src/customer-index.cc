@@ -0,0 +1,188 @@
+#include "customer-index.h"
+#include "fuzzy-match.h"
+#include "normalize.h"
+
+#include <QVariantList>
+
+#include <algorithm>
+
+static bool key_less(const Customer_index::Customer & customer, const QString & key) {
+	return customer.key < key;
+}
+
+Customer_index::Customer_index(QObject * parent) noexcept : QObject(parent) {
+	debounce_.setSingleShot(true);
+	debounce_.setInterval(DEBOUNCE_MS);
+
+	connect(&debounce_, &QTimer::timeout, this, &Customer_index::run_search);
+}
+
+void Customer_index::reset(std::vector<Customer> customers) noexcept {
+	customers_ = std::move(customers);
+
+	std::sort(customers_.begin(), customers_.end(), [](const Customer & a, const Customer & b) {
+		return a.key < b.key;
+	});
+
+	loaded_ = true;
+}
+
+void Customer_index::upsert(const Customer & customer) noexcept {
+	const auto it = std::lower_bound(customers_.begin(), customers_.end(), customer.key, key_less);
+
+	if(it != customers_.end() && it->key == customer.key) {
+		*it = customer;
+	} else {
+		customers_.insert(it, customer);
+	}
+}
+
+void Customer_index::remove(const QString & key) noexcept {
+	const auto it = std::lower_bound(customers_.begin(), customers_.end(), key, key_less);
+
+	if(it != customers_.end() && it->key == key) {
+		customers_.erase(it);
+	}
+}
+
+const Customer_index::Customer * Customer_index::find(const QString & key) const noexcept {
+	const auto it = std::lower_bound(customers_.begin(), customers_.end(), key, key_less);
+	return it != customers_.end() && it->key == key ? &*it : nullptr;
+}
+
+std::vector<Customer_index::Customer> Customer_index::find_prefix(const QString & prefix, const int limit) const noexcept {
+	const auto key = normalize_name(prefix);
+
+	std::vector<Customer> matches;
+
+	for(auto it = std::lower_bound(customers_.begin(), customers_.end(), key, key_less);
+		it != customers_.end() && it->key.startsWith(key) && static_cast<int>(matches.size()) < limit; ++it) {
+		matches.push_back(*it);
+	}
+
+	return matches;
+}
+
+static QString digits_of(const QString & text) {
+	QString digits;
+
+	for(const auto ch : text) {
+
+		if(ch.isDigit()) {
+			digits.append(ch);
+		}
+	}
+
+	return digits;
+}
+
+std::vector<Customer_index::Match> Customer_index::rank(const QString & query, const int limit) const noexcept {
+	std::vector<Match> matches;
+
+	if(limit <= 0) {
+		return matches;
+	}
+
+	if(const auto digits = digits_of(query); !digits.isEmpty()) {
+
+		for(const auto & customer : customers_) {
+
+			if(static_cast<int>(matches.size()) == limit) {
+				break;
+			}
+
+			if(digits_of(customer.phone).contains(digits)) {
+				matches.push_back({customer, "phone"});
+			}
+		}
+
+		return matches;
+	}
+
+	const auto key = normalize_name(query);
+
+	for(const auto & customer : find_prefix(query, limit)) {
+		matches.push_back({customer, "prefix"});
+	}
+
+	if(static_cast<int>(matches.size()) == limit || key.isEmpty()) {
+		return matches;
+	}
+
+	struct Candidate {
+		const Customer * customer;
+		int distance;
+		double similarity;
+	};
+
+	const Fuzzy_pattern pattern(key);
+	const int max_typos = pattern.length() / CHARS_PER_TYPO;
+
+	std::vector<Candidate> candidates;
+
+	for(const auto & customer : customers_) {
+
+		if(customer.key.startsWith(key)) {
+			continue;
+		}
+
+		// a typed part of the name scores as well as the whole of it
+		const int distance = pattern.substring_distance(customer.key);
+
+		if(distance <= max_typos) {
+			candidates.push_back({&customer, distance, trigram_similarity(key, customer.key)});
+		}
+	}
+
+	const auto wanted = std::min(candidates.size(), static_cast<size_t>(limit) - matches.size());
+
+	std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(wanted), candidates.end(), [](const Candidate & a, const Candidate & b) {
+
+		if(a.distance != b.distance) {
+			return a.distance < b.distance;
+		}
+
+		if(a.similarity != b.similarity) {
+			return a.similarity > b.similarity;
+		}
+
+		return a.customer->key < b.customer->key;
+	});
+
+	for(size_t i = 0; i < wanted; ++i) {
+		matches.push_back({*candidates[i].customer, "fuzzy", candidates[i].distance});
+	}
+
+	return matches;
+}
+
+void Customer_index::search(const QString & query, const int limit) noexcept {
+	pending_query_ = query;
+	pending_limit_ = limit;
+	debounce_.start();
+}
+
+void Customer_index::run_search() noexcept {
+	const auto matches = rank(pending_query_, pending_limit_);
+
+	QVariantMap response;
+	response["error"] = false;
+	response["empty"] = matches.empty();
+
+	QVariantList users_list;
+
+	for(const auto & match : matches) {
+		QVariantMap user_data;
+
+		user_data["name"] = match.customer.name;
+		user_data["phone"] = match.customer.phone;
+		user_data["match"] = match.kind;
+		user_data["distance"] = match.distance;
+
+		users_list.append(user_data);
+	}
+
+	response["users"] = users_list;
+
+	emit searchFinished(response);
+}
@@ -0,0 +1,102 @@
+#include "delivery-queue.h"
+
+#include <QMetaObject>
+
+Delivery_queue::Delivery_queue(QObject * owner) noexcept : owner_(owner), head_(&stub_), tail_(&stub_) {
+}
+
+Delivery_queue::~Delivery_queue() noexcept {
+
+	while(auto * node = pop()) {
+		delete node;
+	}
+}
+
+void Delivery_queue::push(Node * node) noexcept {
+	node->next.store(nullptr, std::memory_order_relaxed);
+	auto * prev = head_.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+}
+
+Delivery_queue::Node * Delivery_queue::pop() noexcept {
+	auto * tail = tail_;
+	auto * next = tail->next.load(std::memory_order_acquire);
+
+	if(tail == &stub_) {
+
+		if(!next) {
+			return nullptr;
+		}
+
+		tail_ = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if(next) {
+		tail_ = next;
+		return tail;
+	}
+
+	// a producer swapped the head but has not linked its node yet, the drain it schedules picks it up
+	if(tail != head_.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+
+	push(&stub_);
+	next = tail->next.load(std::memory_order_acquire);
+
+	if(next) {
+		tail_ = next;
+		return tail;
+	}
+
+	return nullptr;
+}
+
+void Delivery_queue::post(Apply apply) noexcept {
+	auto * node = new Node;
+	node->apply = std::move(apply);
+	push(node);
+
+	if(!scheduled_.exchange(true)) {
+		QMetaObject::invokeMethod(owner_, [this]() {
+			schedule();
+		}, Qt::QueuedConnection);
+	}
+}
+
+void Delivery_queue::schedule() noexcept {
+
+	// a hidden window renders no frames, so nothing would drain
+	if(window_ && window_->isExposed()) {
+		return window_->requestUpdate();
+	}
+
+	drain();
+}
+
+void Delivery_queue::set_window(QQuickWindow * window) noexcept {
+	QObject::disconnect(frame_connection_);
+	window_ = window;
+
+	if(window) {
+		// emitted on the gui thread once per frame, before the render thread syncs the scene
+		frame_connection_ = QObject::connect(window, &QQuickWindow::afterAnimating, owner_, [this]() {
+			drain();
+		});
+	}
+}
+
+void Delivery_queue::drain() noexcept {
+	// cleared first, a post racing with the drain schedules another one rather than getting lost
+	scheduled_ = false;
+
+	while(auto * node = pop()) {
+		const auto apply = std::move(node->apply);
+		delete node;
+
+		// what it posts runs later in this same drain
+		apply();
+	}
+}
@@ -8,13 +8,85 @@
 #include <QEventLoop>
 #include <QtGlobal>
 #include <QJsonArray>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QTimer>
+#include <QSet>
+#include <QSettings>
+#include <QRandomGenerator>
+#include <QCryptographicHash>
+#include <QDate>
+#include <QFile>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
 
 const auto DATABASE_URL = QStringLiteral("https://firestore.googleapis.com/v1/projects/ledger-bale/databases/(default)/documents");
 
 using namespace firebase;
 using namespace firestore;
 
-Firebase::Firebase() noexcept {
+Firebase::Firebase() noexcept
+	: delivery_(this),
+	reads_(this, QSettings().value("cache/readTtlMs", DEFAULT_READ_TTL_MS).toInt()),
+	journal_(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal.ndjson")
+{
+	QSettings settings;
+	counter_shards_.stock = std::clamp(settings.value("counters/stockShards", 1).toInt(), 1, Sharded_counters::MAX_SHARDS);
+	counter_shards_.daily = std::clamp(settings.value("counters/dailyShards", 1).toInt(), 1, Sharded_counters::MAX_SHARDS);
+	counter_shards_.monthly = std::clamp(settings.value("counters/monthlyShards", 1).toInt(), 1, Sharded_counters::MAX_SHARDS);
+	counter_shards_.yearly = std::clamp(settings.value("counters/yearlyShards", 1).toInt(), 1, Sharded_counters::MAX_SHARDS);
+	prefetch_days_ = std::clamp(settings.value("cache/prefetchDays", DEFAULT_PREFETCH_DAYS).toInt(), 0, MAX_PREFETCH_DAYS);
+
+	warehouse_ = normalize_name(settings.value("warehouse/current", QString::fromStdString(DEFAULT_WAREHOUSE)).toString()).toStdString();
+	warehouses_ = {DEFAULT_WAREHOUSE};
+
+	if(warehouse_.empty()) {
+		warehouse_ = DEFAULT_WAREHOUSE;
+	} else if(warehouse_ != DEFAULT_WAREHOUSE) {
+		warehouses_.push_back(warehouse_);
+	}
+
+	connect(&customer_index_, &Customer_index::searchFinished, this, &Firebase::getUsersResponse);
+
+	replay_window_.setSingleShot(true);
+	replay_window_.setInterval(COALESCE_WINDOW_MS);
+	connect(&replay_window_, &QTimer::timeout, this, &Firebase::replay_journal);
+
+	// an entry journaled or replayed moves the live totals as much as the store does
+	connect(this, &Firebase::journalChanged, this, [this]() {
+
+		if(live_totals_) {
+			emit_live_totals();
+		}
+	});
+
+	if(!journal_.open()) {
+		qWarning() << "Failed to open the write journal.";
+	}
+
+	startup_day_ = normalize_date(QDate::currentDate().toString("dd-MM-yyyy"));
+
+	// bringing up the sdk takes seconds, so it runs beside the qml load
+	db_ready_ = std::async(std::launch::async, [this, warehouse = warehouse_]() {
+		start_firestore(warehouse);
+	}).share();
+}
+
+Firebase::~Firebase() noexcept {
+	db_ready_.wait();
+	users_listener_.Remove();
+	unsubscribe_daily_records();
+}
+
+void Firebase::start_firestore(const std::string & warehouse) noexcept {
 	AppOptions options;
 	options.set_project_id(PROJECT_ID.data());
 	options.set_api_key(API_KEY.data());
@@ -27,519 +99,3278 @@ Firebase::Firebase() noexcept {
 		return;
 	}
 
-	db_.reset(firestore::Firestore::GetInstance(app_.get()));
+	db_.reset(firestore::Firestore::GetInstance(app_.get()));
+
+	if(!db_) {
+		qWarning() << "Failed to get Firestore instance.";
+		return;
+	}
+
+	// has to be set before anything else touches the instance
+	auto settings = db_->settings();
+	settings.set_persistence_enabled(true);
+	settings.set_cache_size_bytes(static_cast<int64_t>(QSettings().value("cache/localCacheMb", DEFAULT_LOCAL_CACHE_MB).toInt()) * 1024 * 1024);
+	db_->set_settings(settings);
+
+	// the reads the main window makes first, so their round trips overlap the qml load too
+	const auto daily_doc = site_collection(db_.get(), warehouse, "daily_record").Document(startup_day_);
+
+	startup_stock_.start();
+	startup_daily_totals_.start();
+
+	Sharded_counters::read(site_collection(db_.get(), warehouse, "store").Document("stock"), STOCK_FIELDS, [this](const Sharded_counters::Result & result) {
+		startup_stock_.set(result);
+	});
+
+	Sharded_counters::read(daily_doc, TOTAL_FIELDS, [this](const Sharded_counters::Result & result) {
+		startup_daily_totals_.set(result);
+	});
+
+	// set before it is started, so claiming it never has to wait
+	startup_daily_records_.set(daily_doc.Collection("records").Get());
+	startup_daily_records_.start();
+
+	safe_emit([this]() {
+		on_firestore_started();
+	});
+}
+
+void Firebase::on_firestore_started() noexcept {
+
+	if(!db_) {
+		return;
+	}
+
+	started_ = true;
+	emit firestoreStarted();
+
+	listen_to_users();
+	load_warehouses();
+
+	// entries left over from a previous run are committed before anything new
+	replay_journal();
+}
+
+void Firebase::listen_to_users() noexcept {
+
+	users_listener_ = db()->Collection("users").AddSnapshotListener([this, synced = false](const QuerySnapshot & snapshot, const Error error, const std::string & error_message) mutable {
+
+		if(error != Error::kErrorOk) {
+			qWarning() << "Customer listener failed:" << error_message.c_str();
+			return;
+		}
+
+		const auto to_customer = [](const DocumentSnapshot & doc) {
+			return Customer_index::Customer{
+				QString::fromStdString(doc.id()),
+				QString::fromStdString(doc.Get("name").string_value()),
+				QString::fromStdString(doc.Get("phone").string_value()),
+				doc.Get("monthsComplete").is_boolean() && doc.Get("monthsComplete").boolean_value()
+			};
+		};
+
+		if(!synced) {
+
+			// a cached snapshot can be partial, the index only takes over from the network query once complete
+			if(snapshot.metadata().is_from_cache()) {
+				return;
+			}
+
+			synced = true;
+
+			std::vector<Customer_index::Customer> customers;
+
+			for(const auto & doc : snapshot.documents()) {
+				customers.push_back(to_customer(doc));
+			}
+
+			return safe_emit([this, customers = std::move(customers)]() {
+				customer_index_.reset(customers);
+			});
+		}
+
+		std::vector<Customer_index::Customer> upserts;
+		QStringList removals;
+
+		for(const auto & change : snapshot.DocumentChanges()) {
+
+			if(change.type() == DocumentChange::Type::kRemoved) {
+				removals.append(QString::fromStdString(change.document().id()));
+			} else {
+				upserts.push_back(to_customer(change.document()));
+			}
+		}
+
+		safe_emit([this, upserts = std::move(upserts), removals]() {
+
+			for(const auto & customer : upserts) {
+				customer_index_.upsert(customer);
+			}
+
+			for(const auto & key : removals) {
+				customer_index_.remove(key);
+			}
+		});
+	});
+}
+
+void Firebase::get_bale() noexcept {
+
+	if(!reads_.join("stock")) {
+		return;
+	}
+
+	const auto span = tracer_.start("get_bale");
+	const auto revalidation = std::make_shared<Revalidation>();
+
+	const auto to_response = [](const Sharded_counters::Result & result) {
+		QVariantMap response;
+		response["baleAmount"] = static_cast<int>(result.totals.at("baleAmount"));
+		response["baleWeight"] = static_cast<int>(result.totals.at("baleWeight"));
+		response["error"] = false;
+		return response;
+	};
+
+	const auto on_result = [this, span, revalidation, to_response](const Sharded_counters::Result & result) {
+		span.mark(Latency_tracer::Completed);
+
+		if(result.error) {
+			QVariantMap response;
+			response["error"] = true;
+
+			return finish_revalidated(revalidation, "stock", span, false, {}, [this, response]() {
+				emit getBaleResponse(response);
+			});
+		}
+
+		auto response = to_response(result);
+		const QVariant fingerprint = response;
+		response["fresh"] = true;
+
+		finish_revalidated(revalidation, "stock", span, true, fingerprint, [this, response]() {
+			emit getBaleResponse(response);
+		});
+	};
+
+	// startup_day_ is cleared when the warehouse changes, the prefetched stock is then another site's
+	if(!startup_day_.empty() && startup_stock_.claim(on_result)) {
+		return;
+	}
+
+	const auto stock_ref = site("store").Document("stock");
+
+	Sharded_counters::read(stock_ref, STOCK_FIELDS, [this, revalidation, to_response](const Sharded_counters::Result & result) {
+
+		if(result.error) {
+			return;
+		}
+
+		auto response = to_response(result);
+		const QVariant fingerprint = response;
+		response["fresh"] = false;
+
+		paint_cached(revalidation, fingerprint, [this, response]() {
+			emit getBaleResponse(response);
+		});
+	}, Source::kCache);
+
+	Sharded_counters::read(stock_ref, STOCK_FIELDS, on_result, Source::kServer);
+}
+
+void Firebase::set_bale(const int bale_amount, const int bale_weight) noexcept {
+	const auto span = tracer_.start("set_bale");
+
+	auto stock_ref = site("store").Document("stock");
+	auto batch = db()->batch();
+
+	batch.Set(stock_ref, {
+		{"baleAmount", FieldValue::Integer(bale_amount)},
+		{"baleWeight", FieldValue::Integer(bale_weight)}
+	});
+
+	// the new amount replaces whatever the shards had accumulated
+	for(int shard = 0; shard < Sharded_counters::MAX_SHARDS; ++shard) {
+		batch.Delete(stock_ref.Collection("shards").Document(std::to_string(shard)));
+	}
+
+	auto fut = batch.Commit();
+
+	fut.OnCompletion([this, span, bale_amount, bale_weight](const auto & future) {
+		span.mark(Latency_tracer::Completed);
+		QVariantMap response;
+
+		if(future.error() != Error::kErrorOk) {
+			response["error"] = true;
+		} else {
+			response["error"] = false;
+		}
+
+		response["baleAmount"] = bale_amount;
+		response["baleWeight"] = bale_weight;
+
+		traced_emit(span, [this, response]() {
+			// once the commit is done, a read meanwhile would cache the old stock again
+			reads_.invalidate("stock");
+
+			emit this->setBaleResponse(response);
+		});
+	});
+}
+
+Firebase::Record_refs Firebase::record_refs(const std::string & warehouse, const QString & date, const QString & name, const std::string & doc_id,
+	const Counter_shards & shards, const uint32_t shard_salt) const noexcept {
+	Record_refs refs;
+
+	const auto day = normalize_date(date);
+
+	refs.daily_doc = site_collection(db(), warehouse, "daily_record").Document(day);
+	refs.daily_record = refs.daily_doc.Collection("records").Document(doc_id);
+	refs.user_doc = db()->Collection("users").Document(normalize_name(name).toStdString());
+	refs.user_record = refs.user_doc.Collection("records").Document(doc_id);
+	refs.user_month = refs.user_doc.Collection("months").Document(day.substr(0, 6));
+
+	refs.daily_counter = Sharded_counters::shard(refs.daily_doc, shards.daily, shard_salt);
+	refs.monthly = Sharded_counters::shard(site_collection(db(), warehouse, "monthly_totals").Document(day.substr(0, 6)), shards.monthly, shard_salt);
+	refs.yearly = Sharded_counters::shard(site_collection(db(), warehouse, "yearly_totals").Document(day.substr(0, 4)), shards.yearly, shard_salt);
+	refs.stock = Sharded_counters::shard(site_collection(db(), warehouse, "store").Document("stock"), shards.stock, shard_salt);
+
+	return refs;
+}
+
+void Firebase::set_counter_shards(const QString & counter, const int shards) noexcept {
+	const auto clamped = std::clamp(shards, 1, Sharded_counters::MAX_SHARDS);
+
+	if(counter == "stock") {
+		counter_shards_.stock = clamped;
+	} else if(counter == "daily") {
+		counter_shards_.daily = clamped;
+	} else if(counter == "monthly") {
+		counter_shards_.monthly = clamped;
+	} else if(counter == "yearly") {
+		counter_shards_.yearly = clamped;
+	} else {
+		qWarning() << "Unknown counter" << counter;
+		return;
+	}
+
+	QSettings().setValue("counters/" + counter + "Shards", clamped);
+}
+
+void Firebase::set_local_cache_size(const int megabytes) noexcept {
+	// firestore refuses anything under a megabyte
+	QSettings().setValue("cache/localCacheMb", std::max(megabytes, 1));
+}
+
+void Firebase::set_read_cache_ttl(const int ttl_ms) noexcept {
+	reads_.set_ttl(ttl_ms);
+	QSettings().setValue("cache/readTtlMs", reads_.ttl());
+}
+
+void Firebase::set_prefetch_days(const int days) noexcept {
+	prefetch_days_ = std::clamp(days, 0, MAX_PREFETCH_DAYS);
+	QSettings().setValue("cache/prefetchDays", prefetch_days_);
+}
+
+CollectionReference Firebase::site_collection(Firestore * const db, const std::string & warehouse, const char * const name) noexcept {
+
+	// the first site predates the others, so its paths stay where they were
+	if(warehouse.empty() || warehouse == DEFAULT_WAREHOUSE) {
+		return db->Collection(name);
+	}
+
+	return db->Collection("warehouses").Document(warehouse).Collection(name);
+}
+
+std::string Firebase::entry_warehouse(const Journal::Entry & entry) noexcept {
+	// entries journaled before sites existed carry none
+	const auto warehouse = normalize_name(entry.data["warehouse"].toString()).toStdString();
+	return warehouse.empty() ? DEFAULT_WAREHOUSE : warehouse;
+}
+
+void Firebase::set_default_warehouse(const QString & warehouse) noexcept {
+	const auto normalized = normalize_name(warehouse);
+	QSettings().setValue("warehouse/current", normalized.isEmpty() ? QString::fromStdString(DEFAULT_WAREHOUSE) : normalized);
+}
+
+QStringList Firebase::warehouses() const noexcept {
+	QStringList list;
+
+	for(const auto & warehouse : warehouses_) {
+		list.append(QString::fromStdString(warehouse));
+	}
+
+	return list;
+}
+
+void Firebase::set_warehouse(const QString & warehouse) noexcept {
+	const auto normalized = normalize_name(warehouse).toStdString();
+
+	if(normalized.empty() || normalized == warehouse_) {
+		return;
+	}
+
+	warehouse_ = normalized;
+	QSettings().setValue("warehouse/current", QString::fromStdString(warehouse_));
+
+	if(std::find(warehouses_.begin(), warehouses_.end(), warehouse_) == warehouses_.end()) {
+		warehouses_.push_back(warehouse_);
+		emit warehousesChanged();
+	}
+
+	// everything held for the old site is dropped, reads in flight for it see the changed site or generation
+	unsubscribe_daily_records();
+	startup_day_.clear();
+	reads_.clear();
+	adjacent_days_.clear();
+	++prefetch_generation_;
+	range_index_ = Range_index();
+	analytics_.clear();
+	++analytics_generation_;
+
+	emit warehouseChanged();
+}
+
+void Firebase::add_warehouse(const QString & warehouse) noexcept {
+	const auto normalized = normalize_name(warehouse).toStdString();
+
+	if(normalized.empty()) {
+		QVariantMap response;
+		response["error"] = true;
+
+		return emit addWarehouseResponse(response);
+	}
+
+	db()->Collection("warehouses").Document(normalized).Set({{"name", FieldValue::String(warehouse.trimmed().toStdString())}}, SetOptions::Merge())
+		.OnCompletion([this, normalized](const Future<void> & future) {
+
+		QVariantMap response;
+		response["error"] = future.error() != Error::kErrorOk;
+		response["warehouse"] = QString::fromStdString(normalized);
+
+		safe_emit([this, normalized, response]() {
+
+			if(!response["error"].toBool() && std::find(warehouses_.begin(), warehouses_.end(), normalized) == warehouses_.end()) {
+				warehouses_.push_back(normalized);
+				emit warehousesChanged();
+			}
+
+			emit addWarehouseResponse(response);
+		});
+	});
+}
+
+void Firebase::load_warehouses() noexcept {
+
+	if(warehouses_loading_) {
+		return;
+	}
+
+	warehouses_loading_ = true;
+
+	db()->Collection("warehouses").Get().OnCompletion([this](const Future<QuerySnapshot> & future) {
+		const bool loaded = future.error() == Error::kErrorOk;
+		std::vector<std::string> found;
+
+		if(loaded) {
+
+			for(const auto & doc : future.result()->documents()) {
+				found.push_back(doc.id());
+			}
+
+		} else {
+			qWarning() << "Failed to read warehouses:" << future.error_message();
+		}
+
+		safe_emit([this, loaded, found]() {
+			warehouses_loading_ = false;
+			warehouses_loaded_ = warehouses_loaded_ || loaded;
+
+			bool changed = false;
+
+			for(const auto & warehouse : found) {
+
+				if(std::find(warehouses_.begin(), warehouses_.end(), warehouse) == warehouses_.end()) {
+					warehouses_.push_back(warehouse);
+					changed = true;
+				}
+			}
+
+			if(changed) {
+				emit warehousesChanged();
+			}
+
+			for(const auto & waiter : std::exchange(warehouse_waiters_, {})) {
+				waiter(loaded);
+			}
+		});
+	});
+}
+
+void Firebase::read_all_sites(const std::function<DocumentReference(const std::string &)> & counter_of,
+	std::function<void(const std::vector<std::pair<std::string, Sharded_counters::Result>> &)> callback) noexcept {
+
+	if(!warehouses_loaded_) {
+
+		warehouse_waiters_.push_back([this, counter_of, callback](const bool loaded) {
+
+			if(loaded) {
+				return read_all_sites(counter_of, callback);
+			}
+
+			// unread sites make the whole answer an error rather than a short sum
+			Sharded_counters::Result failed;
+			failed.error = true;
+
+			callback({{warehouse_, failed}});
+		});
+
+		return load_warehouses();
+	}
+
+	struct State {
+		std::mutex mutex;
+		std::vector<std::pair<std::string, Sharded_counters::Result>> sites;
+		size_t remaining = 0;
+	};
+
+	auto state = std::make_shared<State>();
+	state->remaining = warehouses_.size();
+
+	for(const auto & warehouse : warehouses_) {
+		state->sites.emplace_back(warehouse, Sharded_counters::Result());
+	}
+
+	// every site is read at once, so the answer waits on the slowest one rather than the sum of them
+	for(size_t i = 0; i < warehouses_.size(); ++i) {
+
+		Sharded_counters::read(counter_of(warehouses_[i]), TOTAL_FIELDS, [state, i, callback](const Sharded_counters::Result & result) {
+			bool done = false;
+
+			{
+				std::lock_guard lock(state->mutex);
+				state->sites[i].second = result;
+				done = --state->remaining == 0;
+			}
+
+			if(done) {
+				callback(state->sites);
+			}
+		});
+	}
+}
+
+void Firebase::answer_consolidated(QVariantMap response, const Latency_tracer::Span & span,
+	const std::vector<std::pair<std::string, Sharded_counters::Result>> & sites) noexcept {
+	span.mark(Latency_tracer::Completed);
+
+	Sharded_counters::Totals merged;
+	QVariantList per_site;
+	bool error = false;
+
+	for(const auto & [warehouse, result] : sites) {
+		// a site that could not be read would leave the sum short
+		error = error || result.error;
+
+		auto site_response = totals_response(result.totals);
+		site_response["warehouse"] = QString::fromStdString(warehouse);
+		site_response["error"] = result.error;
+		per_site.append(site_response);
+
+		for(const auto & [field, value] : result.totals) {
+			merged[field] += value;
+		}
+	}
+
+	response.insert(totals_response(merged));
+	response["error"] = error;
+	response["sites"] = per_site;
+
+	traced_emit(span, [this, response]() {
+		emit getConsolidatedTotalsResponse(response);
+	});
+}
+
+void Firebase::get_consolidated_daily_totals(const QString & date) noexcept {
+	const auto span = tracer_.start("get_consolidated_totals");
+	const auto day = normalize_date(date);
+
+	QVariantMap response;
+	response["scope"] = "day";
+	response["date"] = date;
+
+	read_all_sites([this, day](const std::string & warehouse) {
+		return site_collection(db(), warehouse, "daily_record").Document(day);
+	}, [this, response, span](const auto & sites) {
+		answer_consolidated(response, span, sites);
+	});
+}
+
+void Firebase::get_consolidated_monthly_totals(const int month, const int year) noexcept {
+	const auto span = tracer_.start("get_consolidated_totals");
+	const auto key = (QString::number(year) + QString::number(month).rightJustified(2, '0')).toStdString();
+
+	QVariantMap response;
+	response["scope"] = "month";
+	response["month"] = month;
+	response["year"] = year;
+
+	// the rollups alone, a site with an unbackfilled month reads as zeros there until backfill_rollups runs
+	read_all_sites([this, key](const std::string & warehouse) {
+		return site_collection(db(), warehouse, "monthly_totals").Document(key);
+	}, [this, response, span](const auto & sites) {
+		answer_consolidated(response, span, sites);
+	});
+}
+
+void Firebase::invalidate_reads(const QString & date, const QString & name) noexcept {
+	const auto day = QString::fromStdString(normalize_date(date));
+
+	reads_.invalidate("stock");
+	reads_.invalidate("month:" + day.left(6));
+	reads_.invalidate("year:" + day.left(4));
+	reads_.invalidate("user:" + normalize_name(name));
+
+	adjacent_days_.erase(day.toStdString());
+	++prefetch_generation_;
+}
+
+void Firebase::stage_totals(Coalesced_writes & writes, const DocumentReference & doc, const Record & record, const int sign) noexcept {
+	writes.increment(doc, "totalBaleSold", sign * record.bale_sold);
+	writes.increment(doc, "totalWeightSold", sign * record.weight_sold);
+	writes.increment(doc, "totalAmount", sign * record.amount);
+	writes.increment(doc, "totalReceivedAmount", sign * record.received_amount);
+}
+
+FieldValue Firebase::bucket_entry(const Record & record) noexcept {
+	// leaves out what the bucket's path already says
+	return FieldValue::Map({
+		{"date", FieldValue::String(record.date.toStdString())},
+		{"baleSold", FieldValue::Integer(record.bale_sold)},
+		{"weightSold", FieldValue::Integer(record.weight_sold)},
+		{"rate", FieldValue::Double(record.rate)},
+		{"amount", FieldValue::Integer(record.amount)},
+		{"receivedAmount", FieldValue::Integer(record.received_amount)}
+	});
+}
+
+void Firebase::stage_add_record(Coalesced_writes & writes, const Record_refs & refs, const Record & record, const QString & phone,
+	const bool to_user) noexcept {
+	const auto record_data = MapFieldValue{
+		{"date", FieldValue::String(record.date.toStdString())},
+		{"baleSold", FieldValue::Integer(record.bale_sold)},
+		{"weightSold", FieldValue::Integer(record.weight_sold)},
+		{"rate", FieldValue::Double(record.rate)},
+		{"amount", FieldValue::Integer(record.amount)},
+		{"receivedAmount", FieldValue::Integer(record.received_amount)},
+		{"name", FieldValue::String(record.name.toStdString())},
+		// sortable YYYYMMDD, the history is ordered by it on the server
+		{"day", FieldValue::String(normalize_date(record.date))}
+	};
+
+	writes.set(refs.daily_record, record_data);
+
+	stage_totals(writes, refs.daily_counter, record, 1);
+	stage_totals(writes, refs.monthly, record, 1);
+	stage_totals(writes, refs.yearly, record, 1);
+
+	writes.increment(refs.stock, "baleAmount", -record.bale_sold);
+	writes.increment(refs.stock, "baleWeight", -record.weight_sold);
+
+	if(!to_user) {
+		return;
+	}
+
+	writes.set(refs.user_record, record_data);
+	writes.set_map_entry(refs.user_month, "entries", refs.user_record.id(), bucket_entry(record));
+
+	stage_totals(writes, refs.user_doc, record, 1);
+
+	writes.set_field(refs.user_doc, "name", FieldValue::String(record.name.toStdString()));
+
+	// exports carry no phone, an empty one leaves the customer's as it is
+	if(!phone.isEmpty()) {
+		writes.set_field(refs.user_doc, "phone", FieldValue::String(phone.toStdString()));
+	}
+
+	writes.increment(refs.user_doc, "debt", record.amount - record.received_amount);
+	writes.increment(refs.user_doc, "recordCount", 1);
+}
+
+void Firebase::stage_delete_record(Coalesced_writes & writes, const Record_refs & refs, const Record & record) noexcept {
+	writes.remove(refs.daily_record);
+	writes.remove(refs.user_record);
+	writes.set_map_entry(refs.user_month, "entries", refs.user_record.id(), FieldValue::Delete());
+
+	stage_totals(writes, refs.daily_counter, record, -1);
+	stage_totals(writes, refs.monthly, record, -1);
+	stage_totals(writes, refs.yearly, record, -1);
+	stage_totals(writes, refs.user_doc, record, -1);
+
+	writes.increment(refs.user_doc, "debt", -(record.amount - record.received_amount));
+	writes.increment(refs.user_doc, "recordCount", -1);
+
+	writes.increment(refs.stock, "baleAmount", record.bale_sold);
+	writes.increment(refs.stock, "baleWeight", record.weight_sold);
+}
+
+Firebase::User_dates Firebase::user_dates(const DocumentSnapshot & user) noexcept {
+	User_dates dates;
+
+	if(user.exists()) {
+		dates.exists = true;
+		dates.first_sale = user.Get("firstSaleDay").string_value();
+		dates.last_payment = user.Get("lastPaymentDay").string_value();
+	}
+
+	return dates;
+}
+
+void Firebase::stage_user_dates(Coalesced_writes & writes, const DocumentReference & user_doc, User_dates & dates, const Record & record) noexcept {
+	const auto day = normalize_date(record.date);
+
+	if(!dates.exists) {
+		dates.exists = true;
+		writes.set_field(user_doc, "monthsComplete", FieldValue::Boolean(true));
+	}
+
+	if(dates.first_sale.empty() || day < dates.first_sale) {
+		dates.first_sale = day;
+		writes.set_field(user_doc, "firstSaleDay", FieldValue::String(day));
+	}
+
+	if(record.received_amount > 0 && day > dates.last_payment) {
+		dates.last_payment = day;
+		writes.set_field(user_doc, "lastPaymentDay", FieldValue::String(day));
+	}
+}
+
+void Firebase::add_record(const QVariantMap & data) noexcept {
+	const auto span = tracer_.start("add_record");
+	// generated up front so the journal entry keeps the same docID across retries and restarts
+	const auto doc_id = QString::fromStdString(site("daily_record").Document().id());
+
+	QVariantMap response = data;
+
+	// the record is debited from the site it was entered at, even if the journal replays it after a switch
+	auto entry = data;
+	entry["warehouse"] = QString::fromStdString(warehouse_);
+
+	// a malformed record is refused here, journaled it would fail every replay
+	const auto invalid = Record::invalid_fields(data);
+	const bool journaled = invalid.isEmpty() && journal_.append("add", doc_id, entry);
+
+	// the journal fsync stands in for the store round trip, the commit is traced as replay_journal
+	span.mark(Latency_tracer::Completed);
+
+	if(!journaled) {
+		response["error"] = true;
+
+		if(!invalid.isEmpty()) {
+			response["message"] = invalid;
+		}
+
+		return traced_emit(span, [this, response]() {
+			emit addRecordResponse(response);
+		});
+	}
+
+	invalidate_reads(data["date"].toString(), data["name"].toString());
+
+	response["error"] = false;
+	response["pending"] = true;
+	response["docID"] = doc_id;
+
+	// suggest the customer right away instead of after the replay reaches the listener. a customer the
+	// index does not know yet starts with month buckets
+	const auto key = normalize_name(data["name"].toString());
+	const auto * known = customer_index_.find(key);
+	customer_index_.upsert({key, data["name"].toString(), data["phone"].toString(), known ? known->months : true});
+
+	traced_emit(span, [this, response]() {
+		emit addRecordResponse(response);
+		emit journalChanged();
+	});
+
+	schedule_replay();
+}
+
+void Firebase::schedule_replay() noexcept {
+
+	// let a burst of entries pile up so they share one commit
+	if(!replay_in_flight_ && !replay_window_.isActive()) {
+		replay_window_.start();
+	}
+}
+
+void Firebase::replay_journal() noexcept {
+
+	if(replay_in_flight_ || journal_.pending().empty() || !started_) {
+		return;
+	}
+
+	// entries journaled before records were checked, the store could never take them
+	std::vector<std::pair<Journal::Entry, QString>> malformed;
+
+	for(const auto & entry : journal_.pending()) {
+
+		if(auto reason = malformed_entry(entry); !reason.isEmpty()) {
+			malformed.emplace_back(entry, std::move(reason));
+		}
+	}
+
+	for(const auto & [entry, reason] : malformed) {
+		reject_entry(entry, reason);
+	}
+
+	if(journal_.pending().empty()) {
+		return;
+	}
+
+	replay_in_flight_ = true;
+	replay_window_.stop();
+
+	const auto & pending = journal_.pending();
+	const auto count = std::min(pending.size(), replay_isolating_ > 0 ? size_t(1) : MAX_COALESCED_ENTRIES);
+	const std::vector<Journal::Entry> entries(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(count));
+
+	const auto span = tracer_.start("replay_journal");
+
+	commit_replay(entries, counter_shards_, warehouse_, span);
+}
+
+void Firebase::commit_replay(const std::vector<Journal::Entry> & entries, const Counter_shards & shards, const std::string & warehouse,
+	const Latency_tracer::Span & span) noexcept {
+
+	// one shard per counter for the whole batch keeps the merged increments merged
+	const auto shard_salt = QRandomGenerator::global()->generate();
+
+	// the records the committed attempt added (+1) or removed (-1), for the local range index
+	auto applied = std::make_shared<std::vector<std::pair<Record, int>>>();
+
+	auto fut = db()->RunTransaction([this, entries, applied, shards, shard_salt, warehouse](Transaction & transaction,
+		std::string & error_message) -> Error {
+		// the sdk may rerun this on contention, so everything is rebuilt from the entries each time
+		std::map<QString, std::optional<Record>> current;
+		std::map<std::string, User_dates> users;
+		applied->clear();
+
+		for(const auto & entry : entries) {
+
+			if(!current.count(entry.key)) {
+				Error error = Error::kErrorOk;
+				const auto daily_record = site_collection(db(), entry_warehouse(entry), "daily_record").Document(normalize_date(entry.data["date"].toString()))
+					.Collection("records").Document(entry.key.toStdString());
+				const auto snapshot = transaction.Get(daily_record, &error, &error_message);
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+
+				// the key is the record's docID, so its presence tells whether an earlier attempt already landed. read
+				// in the transaction, a replay racing this one on another device makes it rerun rather than apply twice
+				current[entry.key] = snapshot.exists() ? std::optional<Record>(decode_record(snapshot, snapshot.id())) : std::nullopt;
+			}
+
+			// the customer's dates are widened in the commit, so they are read in it, once per customer
+			if(entry.op != "add") {
+				continue;
+			}
+
+			const auto user_doc = record_refs(entry_warehouse(entry), entry.data["date"].toString(), entry.data["name"].toString(), entry.key.toStdString(), shards, shard_salt).user_doc;
+
+			if(!users.count(user_doc.path())) {
+				Error error = Error::kErrorOk;
+				users[user_doc.path()] = user_dates(transaction.Get(user_doc, &error, &error_message));
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+			}
+		}
+
+		Coalesced_writes writes;
+
+		for(const auto & entry : entries) {
+			auto & existing = current[entry.key];
+
+			if(entry.op == "add") {
+
+				if(!existing) {
+					auto record = Record::from_variant_map(entry.data);
+					record.doc_id = entry.key;
+
+					const auto refs = record_refs(entry_warehouse(entry), record.date, record.name, entry.key.toStdString(), shards, shard_salt);
+
+					stage_add_record(writes, refs, record, entry.data["phone"].toString());
+					// deleting a payment leaves lastPaymentDay where it was, aging stays a lower bound
+					stage_user_dates(writes, refs.user_doc, users[refs.user_doc.path()], record);
+
+					if(entry_warehouse(entry) == warehouse) {
+						applied->emplace_back(record, 1);
+					}
+
+					existing = record;
+				}
+
+			} else if(existing) {
+				stage_delete_record(writes, record_refs(entry_warehouse(entry), existing->date, existing->name, entry.key.toStdString(), shards, shard_salt), *existing);
+
+				if(entry_warehouse(entry) == warehouse) {
+					applied->emplace_back(*existing, -1);
+				}
+
+				existing.reset();
+			}
+		}
+
+		writes.apply(transaction);
+		return Error::kErrorOk;
+	});
+
+	fut.OnCompletion([this, span, entries, applied, warehouse](const Future<void> & future) {
+		span.mark(Latency_tracer::Completed);
+		const auto error = static_cast<Error>(future.error());
+		const auto message = QString::fromUtf8(future.error_message());
+
+		if(error != Error::kErrorOk) {
+			qWarning() << "Journal replay failed:" << message;
+		}
+
+		traced_emit(span, [this, entries, error, message, warehouse, applied = *applied]() {
+			// a site switched to meanwhile has a range index of its own, reloaded from the store
+			on_journal_entries_replayed(entries, error, message, warehouse == warehouse_ ? applied : std::vector<std::pair<Record, int>>{});
+		});
+	});
+}
+
+bool Firebase::permanent_error(const Error error) noexcept {
+
+	switch(error) {
+
+		case Error::kErrorInvalidArgument:
+		case Error::kErrorNotFound:
+		case Error::kErrorAlreadyExists:
+		case Error::kErrorPermissionDenied:
+		case Error::kErrorFailedPrecondition:
+		case Error::kErrorOutOfRange:
+		case Error::kErrorUnimplemented:
+		case Error::kErrorDataLoss:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+QString Firebase::malformed_entry(const Journal::Entry & entry) noexcept {
+
+	if(entry.op == "add") {
+		return Record::invalid_fields(entry.data);
+	}
+
+	if(entry.key.isEmpty() || !valid_date(entry.data["date"].toString())) {
+		return "docID and a DD-MM-YYYY date are required";
+	}
+
+	return {};
+}
+
+void Firebase::reject_entry(const Journal::Entry & entry, const QString & reason) noexcept {
+	qWarning() << "Setting aside a journal entry the store cannot take:" << entry.op << entry.key << reason;
+
+	journal_.reject({entry.seq}, reason);
+	emit journalChanged();
+
+	QVariantMap response;
+	response["op"] = entry.op;
+	response["docID"] = entry.key;
+	response["date"] = entry.data["date"];
+	response["name"] = entry.data["name"];
+	response["reason"] = reason;
+
+	emit journalEntryRejected(response);
+}
+
+void Firebase::on_journal_entries_replayed(const std::vector<Journal::Entry> & entries, const Error error, const QString & message,
+	const std::vector<std::pair<Record, int>> & applied) noexcept {
+	replay_in_flight_ = false;
+
+	const bool committed = error == Error::kErrorOk;
+
+	if(!committed && !permanent_error(error)) {
+		replay_retry_ms_ = std::min(std::max(replay_retry_ms_ * 2, 1000), 60000);
+		QTimer::singleShot(replay_retry_ms_, this, &Firebase::replay_journal);
+		return;
+	}
+
+	replay_retry_ms_ = 0;
+
+	// the batch does not say which entry was refused, so they go out one by one until it shows
+	if(!committed && entries.size() > 1) {
+		replay_isolating_ = entries.size();
+		return replay_journal();
+	}
+
+	if(replay_isolating_ > 0) {
+		--replay_isolating_;
+	}
+
+	QList<qint64> seqs;
+	QSet<QString> deleted_from;
+
+	for(const auto & entry : entries) {
+		seqs.append(entry.seq);
+		invalidate_reads(entry.data["date"].toString(), entry.data["name"].toString());
+
+		if(entry.op == "delete") {
+			deleted_from.insert(normalize_name(entry.data["name"].toString()));
+		}
+	}
+
+	if(!committed) {
+		reject_entry(entries.front(), message);
+		return replay_journal();
+	}
+
+	// the oldest entry waited the longest
+	last_replay_latency_ms_ = static_cast<int>(QDateTime::currentMSecsSinceEpoch() - entries.front().created_ms);
+
+	journal_.complete(seqs);
+	emit journalChanged();
+
+	if(range_index_.loaded()) {
+
+		for(const auto & [record, sign] : applied) {
+			Range_index::Totals delta;
+			delta.bale_sold = sign * record.bale_sold;
+			delta.weight_sold = sign * record.weight_sold;
+			delta.amount = sign * record.amount;
+			delta.received_amount = sign * record.received_amount;
+
+			range_index_.add(normalize_date(record.date), delta);
+		}
+	}
+
+	for(const auto & name : deleted_from) {
+		cleanup_empty_user(name);
+	}
+
+	// whatever arrived during the commit goes out as the next batch
+	replay_journal();
+}
+
+void Firebase::get_daily_records(const QString & date) noexcept {
+	const auto span = tracer_.start("get_daily_records");
+	const auto revalidation = std::make_shared<Revalidation>();
+	auto doc_ref = site("daily_record").Document(normalize_date(date));
+
+	// the first look at today takes over the reads made while firestore was starting
+	Future<QuerySnapshot> startup_records;
+	const bool startup = doc_ref.id() == startup_day_ && startup_daily_records_.claim([&startup_records](const Future<QuerySnapshot> & future) {
+		startup_records = future;
+	});
+
+	if(const auto * adjacent = adjacent_days_.find(doc_ref.id())) {
+		// read ahead while a neighbouring day was shown, no need to wait for the disk either
+		paint_cached(revalidation, adjacent->fingerprint(), [this, view = *adjacent]() {
+			deliver_daily_view(view, false);
+		});
+
+	} else if(!startup) {
+
+		read_daily_view(doc_ref, Source::kCache, {}, false, [this, revalidation](const Daily_view & view) {
+
+			if(!view.error) {
+				paint_cached(revalidation, view.fingerprint(), [this, view]() {
+					deliver_daily_view(view, false);
+				});
+			}
+		});
+	}
+
+	const auto generation = prefetch_generation_;
+
+	read_daily_view(doc_ref, Source::kServer, startup_records, startup, [this, span, revalidation, generation](const Daily_view & view) {
+		span.mark(Latency_tracer::Completed);
+
+		if(!view.error) {
+			safe_emit([this, view, generation]() {
+
+				if(generation == prefetch_generation_) {
+					adjacent_days_.put(view.day, view);
+				}
+
+				prefetch_adjacent_days(view.day);
+			});
+		}
+
+		// days are not coalesced, there is no read key
+		finish_revalidated(revalidation, QString(), span, !view.error, view.fingerprint(), [this, view]() {
+			deliver_daily_view(view, true);
+		});
+	});
+}
+
+QVariant Firebase::Daily_view::fingerprint() const noexcept {
+	QVariantList rows;
+
+	for(const auto & record : records) {
+		rows.append(record.to_variant_map());
+	}
+
+	return QVariantList{metadata, response.value_or(QVariantMap()), rows};
+}
+
+void Firebase::read_daily_view(const DocumentReference & day_doc, const Source source, const Future<QuerySnapshot> & startup_records,
+	const bool startup_totals, std::function<void(const Daily_view &)> callback) noexcept {
+
+	struct State {
+		std::mutex mutex;
+		std::optional<Sharded_counters::Result> totals;
+		std::optional<Future<QuerySnapshot>> records;
+	};
+
+	auto state = std::make_shared<State>();
+
+	// the records are read alongside the totals rather than after them. a day the totals call empty drops them
+	const auto settle = [state, day = day_doc.id(), callback]() {
+		callback(daily_view(day, *state->totals, *state->records));
+	};
+
+	const auto on_totals = [state, settle](const Sharded_counters::Result & result) {
+		bool ready = false;
+
+		{
+			std::lock_guard lock(state->mutex);
+			state->totals = result;
+			ready = state->records.has_value();
+		}
+
+		if(ready) {
+			settle();
+		}
+	};
+
+	auto records_fut = startup_records.status() == kFutureStatusInvalid ? day_doc.Collection("records").Get(source) : startup_records;
+
+	records_fut.OnCompletion([state, settle](const Future<QuerySnapshot> & future) {
+		bool ready = false;
+
+		{
+			std::lock_guard lock(state->mutex);
+			state->records = future;
+			ready = state->totals.has_value();
+		}
+
+		if(ready) {
+			settle();
+		}
+	});
+
+	if(!startup_totals || !startup_daily_totals_.claim(on_totals)) {
+		Sharded_counters::read(day_doc, TOTAL_FIELDS, on_totals, source);
+	}
+}
+
+Firebase::Daily_view Firebase::daily_view(const std::string & day, const Sharded_counters::Result & totals, const Future<QuerySnapshot> & records) noexcept {
+	Daily_view view;
+	view.day = day;
+
+	if(totals.error) {
+		view.error = true;
+		view.metadata["error"] = true;
+		return view;
+	}
+
+	if(!totals.exists) {
+		view.metadata["empty"] = true;
+		return view;
+	}
+
+	view.metadata = totals_response(totals.totals);
+	view.metadata["empty"] = false;
+
+	QVariantMap response;
+
+	if(records.error() != Error::kErrorOk) {
+		view.error = true;
+		response["error"] = true;
+		response["message"] = QString::fromStdString(records.error_message());
+		view.response = response;
+
+		return view;
+	}
+
+	const auto * docs = records.result();
+
+	response["empty"] = !docs || docs->documents().empty();
+	response["error"] = false;
+
+	if(docs) {
+		view.records.reserve(static_cast<qsizetype>(docs->documents().size()));
+
+		for(const auto & doc : docs->documents()) {
+
+			if(doc.exists()) {
+				view.records.append(decode_record(doc, doc.id()));
+			}
+		}
+	}
+
+	view.response = response;
+	return view;
+}
+
+void Firebase::prefetch_adjacent_days(const std::string & day) noexcept {
+	const auto date = QDate::fromString(QString::fromStdString(day), "yyyyMMdd");
+	const auto today = QDate::currentDate();
+	const auto generation = prefetch_generation_;
+
+	// nearest days first, nothing is recorded ahead of today
+	for(int offset = 1; offset <= prefetch_days_; ++offset) {
+
+		for(const auto & adjacent_date : {date.addDays(-offset), date.addDays(offset)}) {
+			const auto adjacent = adjacent_date.toString("yyyyMMdd").toStdString();
+
+			if(adjacent_date > today || adjacent_days_.contains(adjacent) || !prefetching_days_.insert(adjacent).second) {
+				continue;
+			}
+
+			read_daily_view(site("daily_record").Document(adjacent), Source::kServer, {}, false, [this, generation](const Daily_view & view) {
+
+				safe_emit([this, generation, view]() {
+					prefetching_days_.erase(view.day);
+
+					if(!view.error && generation == prefetch_generation_) {
+						adjacent_days_.put(view.day, view);
+					}
+				});
+			});
+		}
+	}
+}
+
+void Firebase::deliver_daily_view(const Daily_view & view, const bool fresh) noexcept {
+	auto metadata = view.metadata;
+	metadata["fresh"] = fresh;
+
+	auto records = view.records;
+	std::optional<QVariantMap> response = view.response;
+
+	const auto pending = view.error ? Sharded_counters::Totals() : overlay_pending(view.day, records);
+
+	if(!pending.empty()) {
+
+		// a day only the journal knows of yet
+		if(!response) {
+			metadata.insert(totals_response({}));
+			response = QVariantMap{{"error", false}};
+		}
+
+		for(const auto & [field, delta] : pending) {
+			const auto key = QString::fromStdString(field);
+			metadata[key] = metadata[key].toInt() + static_cast<int>(delta);
+		}
+
+		metadata["empty"] = false;
+		(*response)["empty"] = records.isEmpty();
+	}
+
+	emit getDailyRecordsResponseMetadata(metadata);
+
+	if(!response) {
+		return;
+	}
+
+	(*response)["fresh"] = fresh;
+
+	if(!(*response)["error"].toBool()) {
+		// the totals go out with the records, so the view updates once
+		daily_records_.set_records(records);
+	}
+
+	emit getDailyRecordsResponse(*response);
+}
+
+Sharded_counters::Totals Firebase::overlay_pending(const std::string & day, QList<Record> & records) const noexcept {
+	Sharded_counters::Totals totals;
+
+	for(const auto & entry : journal_.pending()) {
+
+		if(entry_warehouse(entry) != warehouse_ || normalize_date(entry.data["date"].toString()) != day) {
+			continue;
+		}
+
+		const auto row = std::find_if(records.begin(), records.end(), [&entry](const Record & record) {
+			return record.doc_id == entry.key;
+		});
+
+		// the store may have caught up with the entry while it was read, an entry only counts when it has not
+		Record record;
+		int sign = 0;
+
+		if(entry.op == "add" && row == records.end()) {
+			record = Record::from_variant_map(entry.data);
+			record.doc_id = entry.key;
+			records.append(record);
+			sign = 1;
+
+		} else if(entry.op == "delete" && row != records.end()) {
+			record = *row;
+			records.erase(row);
+			sign = -1;
+
+		} else {
+			continue;
+		}
+
+		totals["totalBaleSold"] += sign * record.bale_sold;
+		totals["totalWeightSold"] += sign * record.weight_sold;
+		totals["totalAmount"] += sign * record.amount;
+		totals["totalReceivedAmount"] += sign * record.received_amount;
+	}
+
+	return totals;
+}
+
+void Firebase::emit_live_totals() noexcept {
+	auto response = *live_totals_;
+
+	if(response["error"].toBool()) {
+		return emit dailyTotalsChanged(response);
+	}
+
+	// the store's rows tell which entries it has caught up with
+	auto records = live_stored_;
+	const auto pending = overlay_pending(live_day_, records);
+
+	if(!pending.empty()) {
+
+		if(response["empty"].toBool()) {
+			response.insert(totals_response({}));
+		}
+
+		for(const auto & [field, delta] : pending) {
+			const auto key = QString::fromStdString(field);
+			response[key] = response[key].toInt() + static_cast<int>(delta);
+		}
+
+		response["empty"] = false;
+	}
+
+	emit dailyTotalsChanged(response);
+}
+
+void Firebase::set_live_updates(const bool live_updates) noexcept {
+
+	if(live_updates_ == live_updates) {
+		return;
+	}
+
+	live_updates_ = live_updates;
+
+	if(!live_updates_) {
+		unsubscribe_daily_records();
+	}
+
+	emit liveUpdatesChanged();
+}
+
+void Firebase::subscribe_daily_records(const QString & date) noexcept {
+	unsubscribe_daily_records();
+
+	// callbacks already queued for an older subscription compare against this and drop themselves
+	const auto generation = ++daily_subscription_generation_;
+	auto doc_ref = site("daily_record").Document(normalize_date(date));
+	live_day_ = doc_ref.id();
+
+	daily_totals_listeners_ = Sharded_counters::listen(doc_ref, TOTAL_FIELDS, [this, generation](const Sharded_counters::Result & result) {
+		QVariantMap response;
+
+		if(result.error) {
+			response["error"] = true;
+		} else if(!result.exists) {
+			response["error"] = false;
+			response["empty"] = true;
+		} else {
+			response = totals_response(result.totals);
+			response["error"] = false;
+			response["empty"] = false;
+		}
+
+		safe_emit([this, generation, response]() {
+
+			if(generation == daily_subscription_generation_) {
+				live_totals_ = response;
+				emit_live_totals();
+			}
+		});
+	});
+
+	daily_records_listener_ = doc_ref.Collection("records").AddSnapshotListener(
+		[this, generation, day = doc_ref.id(), first = true](const QuerySnapshot & snapshot, const Error error, const std::string & error_message) mutable {
+
+		QVariantMap response;
+
+		if(error != Error::kErrorOk) {
+			response["error"] = true;
+			response["message"] = QString::fromStdString(error_message);
+
+			return safe_emit([this, generation, response]() {
+
+				if(generation == daily_subscription_generation_) {
+					emit getDailyRecordsResponse(response);
+				}
+			});
+		}
+
+		// the first snapshot fills the model in one go, everything after it arrives as a diff
+		if(first) {
+			first = false;
+
+			const auto docs = snapshot.documents();
+
+			QList<Record> records;
+			records.reserve(static_cast<qsizetype>(docs.size()));
+
+			for(const auto & doc : docs) {
+				records.append(decode_record(doc, doc.id()));
+			}
+
+			response["error"] = false;
+			response["empty"] = records.isEmpty();
+
+			return safe_emit([this, generation, day, response, records]() mutable {
+
+				if(generation == daily_subscription_generation_) {
+					live_stored_ = records;
+
+					if(live_totals_) {
+						emit_live_totals();
+					}
+
+					// the totals listener reports the store's totals only, the rows the journal still holds are added here
+					overlay_pending(day, records);
+					response["empty"] = records.isEmpty();
+
+					daily_records_.set_records(records);
+					emit getDailyRecordsResponse(response);
+				}
+			});
+		}
+
+		QList<Record> upserts;
+		QStringList removals;
+
+		for(const auto & change : snapshot.DocumentChanges()) {
+			const auto & doc = change.document();
+
+			if(change.type() == DocumentChange::Type::kRemoved) {
+				removals.append(QString::fromStdString(doc.id()));
+			} else {
+				upserts.append(decode_record(doc, doc.id()));
+			}
+		}
+
+		safe_emit([this, generation, upserts, removals]() {
+
+			if(generation != daily_subscription_generation_) {
+				return;
+			}
+
+			for(const auto & record : upserts) {
+				daily_records_.add_record(record);
+
+				const auto stored = std::find_if(live_stored_.begin(), live_stored_.end(), [&record](const Record & row) {
+					return row.doc_id == record.doc_id;
+				});
+
+				if(stored == live_stored_.end()) {
+					live_stored_.append(record);
+				} else {
+					*stored = record;
+				}
+			}
+
+			for(const auto & doc_id : removals) {
+				daily_records_.remove_record(doc_id);
+
+				live_stored_.erase(std::remove_if(live_stored_.begin(), live_stored_.end(), [&doc_id](const Record & row) {
+					return row.doc_id == doc_id;
+				}), live_stored_.end());
+			}
+
+			if(live_totals_) {
+				emit_live_totals();
+			}
+		});
+	});
+
+	stock_listeners_ = Sharded_counters::listen(site("store").Document("stock"), STOCK_FIELDS,
+		[this, generation](const Sharded_counters::Result & result) {
+
+		QVariantMap response;
+
+		if(result.error) {
+			response["error"] = true;
+		} else {
+			response["error"] = false;
+			response["baleAmount"] = static_cast<int>(result.totals.at("baleAmount"));
+			response["baleWeight"] = static_cast<int>(result.totals.at("baleWeight"));
+		}
+
+		safe_emit([this, generation, response]() {
+			// another counter moved the stock
+			reads_.invalidate("stock");
+
+			if(generation == daily_subscription_generation_) {
+				emit stockChanged(response);
+			}
+		});
+	});
+}
+
+void Firebase::unsubscribe_daily_records() noexcept {
+	++daily_subscription_generation_;
+
+	daily_records_listener_.Remove();
+	live_totals_.reset();
+	live_stored_.clear();
+
+	for(auto * listeners : {&daily_totals_listeners_, &stock_listeners_}) {
+
+		for(auto & listener : *listeners) {
+			listener.Remove();
+		}
+
+		listeners->clear();
+	}
+}
+
+void Firebase::get_user_records(const QString & name) noexcept {
+	const auto normalized_name = normalize_name(name);
+
+	// every open claims the popup, whether it is answered by firestore, the cache or a read in flight
+	++user_records_generation_;
+	user_records_name_ = normalized_name;
+	user_records_has_more_ = false;
+	user_records_loading_ = true;
+
+	const auto read_key = "user:" + normalized_name;
+
+	if(!reads_.join(read_key)) {
+		return;
+	}
+
+	const auto span = tracer_.start("get_user_records");
+	const auto revalidation = std::make_shared<Revalidation>();
+
+	auto user_doc_ref = db()->Collection("users").Document(normalized_name.toStdString());
+
+	const auto * customer = customer_index_.find(normalized_name);
+	const bool months = customer && customer->months;
+
+	read_user_view(user_doc_ref, Source::kCache, months, [this, revalidation, normalized_name](const User_view & view) {
+
+		if(!view.error && view.page) {
+			paint_cached(revalidation, view.fingerprint(), [this, normalized_name, view]() {
+				deliver_user_view(normalized_name, view, false);
+			});
+		}
+	});
+
+	read_user_view(user_doc_ref, Source::kServer, months, [this, span, revalidation, read_key, normalized_name](const User_view & view) {
+		span.mark(Latency_tracer::Completed);
+
+		finish_revalidated(revalidation, read_key, span, !view.error, view.fingerprint(), [this, normalized_name, view]() {
+			deliver_user_view(normalized_name, view, true);
+		});
+	});
+}
+
+QVariant Firebase::User_view::fingerprint() const noexcept {
+	QVariantList rows;
+
+	if(page) {
+
+		for(const auto & record : page->records) {
+			rows.append(record.to_variant_map());
+		}
+	}
+
+	return QVariantList{metadata, page ? page->response : QVariantMap(), rows};
+}
+
+Query Firebase::user_history_query(const DocumentReference & user_doc, const bool months) noexcept {
+	// customers whose every record is in the month buckets load a page of months instead of a page of records
+	return months ? user_doc.Collection("months").OrderBy(FieldPath::DocumentId(), Query::Direction::kDescending)
+		: user_doc.Collection("records").OrderBy("day", Query::Direction::kDescending);
+}
+
+void Firebase::read_user_view(const DocumentReference & user_doc, const Source source, const bool months,
+	std::function<void(const User_view &)> callback) noexcept {
+
+	struct State {
+		std::mutex mutex;
+		std::optional<Future<DocumentSnapshot>> customer;
+		std::optional<Future<QuerySnapshot>> history;
+	};
+
+	auto state = std::make_shared<State>();
+
+	const auto settle = [user_doc, source, months, callback](const Future<DocumentSnapshot> & customer, const Future<QuerySnapshot> & history) {
+		User_view view;
+
+		if(customer.error() != Error::kErrorOk) {
+			view.error = true;
+			view.metadata["error"] = true;
+			return callback(view);
+		}
+
+		const auto * doc = customer.result();
+
+		if(!doc || !doc->exists()) {
+			view.metadata["empty"] = true;
+			return callback(view);
+		}
+
+		const auto name = QString::fromStdString(doc->Get("name").string_value());
+
+		view.metadata["name"] = name;
+		view.metadata["phone"] = QString::fromStdString(doc->Get("phone").string_value());
+		view.metadata["totalBaleSold"] = static_cast<int>(doc->Get("totalBaleSold").integer_value());
+		view.metadata["totalWeightSold"] = static_cast<int>(doc->Get("totalWeightSold").integer_value());
+		view.metadata["totalAmount"] = static_cast<int>(doc->Get("totalAmount").integer_value());
+		view.metadata["totalReceivedAmount"] = static_cast<int>(doc->Get("totalReceivedAmount").integer_value());
+		view.metadata["debt"] = static_cast<int>(doc->Get("debt").integer_value());
+
+		view.months = doc->Get("monthsComplete").is_boolean() && doc->Get("monthsComplete").boolean_value();
+		view.whole = !view.months && !(doc->Get("daysComplete").is_boolean() && doc->Get("daysComplete").boolean_value());
+		view.query = view.whole ? user_doc.Collection("records") : user_history_query(user_doc, view.months);
+
+		auto finish = [view, name, callback](const Future<QuerySnapshot> & future) mutable {
+			view.page = user_records_page(future, view.months, name);
+			view.error = view.page->response["error"].toBool();
+
+			if(view.whole) {
+				std::sort(view.page->records.begin(), view.page->records.end(), [](const Record & a, const Record & b) {
+					const auto a_day = normalize_date(a.date);
+					const auto b_day = normalize_date(b.date);
+					return a_day != b_day ? a_day > b_day : a.doc_id > b.doc_id;
+				});
+
+				view.page->has_more = false;
+				view.page->response["hasMore"] = false;
+			}
+
+			callback(view);
+		};
+
+		if(view.whole) {
+			return view.query.Get(source).OnCompletion(finish);
+		}
+
+		if(view.months == months) {
+			return finish(history);
+		}
+
+		view.query.Limit(user_history_page_size(view.months)).Get(source).OnCompletion(finish);
+	};
+
+	user_doc.Get(source).OnCompletion([state, settle](const Future<DocumentSnapshot> & future) {
+		std::optional<Future<QuerySnapshot>> history;
+
+		{
+			std::lock_guard lock(state->mutex);
+			state->customer = future;
+			history = state->history;
+		}
+
+		if(history) {
+			settle(future, *history);
+		}
+	});
+
+	user_history_query(user_doc, months).Limit(user_history_page_size(months)).Get(source).OnCompletion([state, settle](const Future<QuerySnapshot> & future) {
+		std::optional<Future<DocumentSnapshot>> customer;
+
+		{
+			std::lock_guard lock(state->mutex);
+			state->history = future;
+			customer = state->customer;
+		}
+
+		if(customer) {
+			settle(*customer, future);
+		}
+	});
+}
+
+void Firebase::deliver_user_view(const QString & normalized_name, const User_view & view, const bool fresh) noexcept {
+
+	// a different customer was opened while this history was in flight
+	if(normalized_name != user_records_name_) {
+		return;
+	}
+
+	auto metadata = view.metadata;
+	metadata["fresh"] = fresh;
+
+	// the metadata waits for the first page so a cached history replays both in one go
+	emit getUserRecordsResponseMetadata(metadata);
+
+	// an unknown or unreadable customer has no pages to load
+	if(!view.page) {
+		user_records_loading_ = false;
+		user_records_has_more_ = false;
+		return;
+	}
+
+	user_records_query_ = view.query;
+	user_records_months_ = view.months;
+	user_records_display_name_ = view.metadata["name"].toString();
+	user_records_loading_ = false;
+	user_records_has_more_ = view.page->has_more;
+	user_records_cursor_ = view.page->cursor;
+
+	auto response = view.page->response;
+	response["fresh"] = fresh;
+
+	user_records_.set_records(view.page->records);
+	emit getUserRecordsResponse(response);
+}
+
+void Firebase::get_more_user_records() noexcept {
+
+	if(!user_records_has_more_ || user_records_loading_) {
+		return;
+	}
+
+	user_records_loading_ = true;
+	load_user_records_page(user_records_query_.StartAfter(user_records_cursor_), user_records_months_, user_records_display_name_,
+		user_records_generation_, tracer_.start("get_more_user_records"));
+}
+
+// lets decode_record read an entry of a month bucket, which leaves out the customer's name
+struct Bucket_entry {
+	const MapFieldValue & fields;
+	const FieldValue & name;
+
+	FieldValue Get(const std::string & field) const {
+
+		if(field == "name") {
+			return name;
+		}
+
+		const auto it = fields.find(field);
+		return it == fields.end() ? FieldValue::Null() : it->second;
+	}
+};
+
+Firebase::User_records_page Firebase::user_records_page(const Future<QuerySnapshot> & future, const bool months, const QString & name) noexcept {
+	User_records_page page;
+
+	if(future.error() != Error::kErrorOk) {
+		page.response["error"] = true;
+		return page;
+	}
+
+	const auto docs = future.result()->documents();
+
+	page.response["error"] = false;
+
+	if(months) {
+		const auto name_value = FieldValue::String(name.toStdString());
+
+		for(const auto & doc : docs) {
+			const auto entries = doc.Get("entries");
+
+			if(!entries.is_map()) {
+				continue;
+			}
+
+			QList<Record> month;
+
+			for(const auto & [doc_id, entry] : entries.map_value()) {
+
+				if(entry.is_map()) {
+					month.append(decode_record(Bucket_entry{entry.map_value(), name_value}, doc_id));
+				}
+			}
+
+			// the buckets come newest first, their entries are in docID order
+			std::sort(month.begin(), month.end(), [](const Record & a, const Record & b) {
+				const auto a_day = normalize_date(a.date);
+				const auto b_day = normalize_date(b.date);
+				return a_day != b_day ? a_day > b_day : a.doc_id > b.doc_id;
+			});
+
+			page.records.append(month);
+		}
+
+	} else {
+		page.records.reserve(static_cast<qsizetype>(docs.size()));
+
+		for(const auto & doc : docs) {
+			page.records.append(decode_record(doc, doc.id()));
+		}
+	}
+
+	page.response["empty"] = page.records.isEmpty();
+
+	if(docs.empty()) {
+		return page;
+	}
+
+	page.has_more = docs.size() == user_history_page_size(months);
+	page.cursor = docs.back();
+	page.response["hasMore"] = page.has_more;
+
+	return page;
+}
+
+void Firebase::load_user_records_page(const Query & query, const bool months, const QString & name, const int generation, const Latency_tracer::Span & span) noexcept {
+
+	query.Limit(user_history_page_size(months)).Get().OnCompletion([this, span, months, name, generation](const Future<QuerySnapshot> & future) {
+		span.mark(Latency_tracer::Completed);
+
+		traced_emit(span, [this, generation, page = user_records_page(future, months, name)]() {
+
+			// a different customer was opened while this page was in flight
+			if(generation != user_records_generation_) {
+				return;
+			}
+
+			user_records_loading_ = false;
+			user_records_has_more_ = page.has_more;
+			user_records_cursor_ = page.cursor;
+
+			user_records_.append_records(page.records);
+			emit getMoreUserRecordsResponse(page.response);
+		});
+	});
+}
+
+void Firebase::backfill_record_days() noexcept {
+	const auto ordered = db()->CollectionGroup("records").OrderBy(FieldPath::DocumentId());
+	backfill_record_days_page(ordered, ordered, 0);
+}
+
+void Firebase::backfill_record_days_page(const Query & ordered, const Query & page, const int updated) noexcept {
+
+	page.Limit(MAX_BATCH_WRITES).Get().OnCompletion([this, ordered, updated](const auto & future) {
+		QVariantMap response;
+
+		if(future.error() != Error::kErrorOk) {
+			response["error"] = true;
+
+			return safe_emit([this, response]() {
+				emit backfillRecordDaysResponse(response);
+			});
+		}
+
+		const auto docs = future.result()->documents();
+
+		if(docs.empty()) {
+			return mark_days_complete(updated);
+		}
+
+		auto batch = db()->batch();
+		int staged = 0;
+
+		for(const auto & doc : docs) {
+			const auto date = QString::fromStdString(doc.Get("date").string_value());
+
+			if(doc.Get("day").is_string() || date.count('-') != 2) {
+				continue;
+			}
+
+			batch.Update(doc.reference(), {{"day", FieldValue::String(normalize_date(date))}});
+			++staged;
+		}
+
+		const auto next = ordered.StartAfter(docs.back());
+
+		batch.Commit().OnCompletion([this, ordered, next, updated, staged](const Future<void> & future) {
+
+			if(future.error() != Error::kErrorOk) {
+				QVariantMap response;
+				response["error"] = true;
+
+				return safe_emit([this, response]() {
+					emit backfillRecordDaysResponse(response);
+				});
+			}
+
+			backfill_record_days_page(ordered, next, updated + staged);
+		});
+	});
+}
+
+void Firebase::mark_days_complete(const int updated) noexcept {
+
+	// every record has its day now, the customers' histories can be paged in order
+	db()->Collection("users").Get().OnCompletion([this, updated](const Future<QuerySnapshot> & future) {
+		auto error = std::make_shared<std::atomic<bool>>(future.error() != Error::kErrorOk);
+
+		const auto finish = [this, updated, error]() {
+			QVariantMap response;
+			response["error"] = error->load();
+			response["updated"] = updated;
+
+			safe_emit([this, response]() {
+				reads_.clear();
+				emit backfillRecordDaysResponse(response);
+			});
+		};
+
+		if(*error || future.result()->documents().empty()) {
+			return finish();
+		}
+
+		const auto users = future.result()->documents();
+		auto remaining = std::make_shared<std::atomic<size_t>>((users.size() + MAX_BATCH_WRITES - 1) / MAX_BATCH_WRITES);
+
+		for(size_t i = 0; i < users.size(); i += MAX_BATCH_WRITES) {
+			auto batch = db()->batch();
+
+			for(size_t j = i; j < std::min(users.size(), i + MAX_BATCH_WRITES); ++j) {
+				batch.Set(users[j].reference(), {{"daysComplete", FieldValue::Boolean(true)}}, SetOptions::Merge());
+			}
+
+			batch.Commit().OnCompletion([remaining, error, finish](const Future<void> & future) {
+
+				if(future.error() != Error::kErrorOk) {
+					*error = true;
+				}
+
+				if(--*remaining == 0) {
+					finish();
+				}
+			});
+		}
+	});
+}
+
+struct Firebase::Export_state {
+	std::string warehouse;
+	QFile file;
+	Record_rows::Format format = Record_rows::Format::Csv;
+	QDate day;
+	QDate last;
+	// last document of the previous full page of the current day
+	DocumentSnapshot cursor;
+	qint64 written = 0;
+};
+
+void Firebase::export_records(const QString & from, const QString & to, const QString & path) noexcept {
+	auto state = std::make_shared<Export_state>();
+
+	state->warehouse = warehouse_;
+	state->format = Record_rows::format_of(path);
+	state->day = QDate::fromString(from, "dd-MM-yyyy");
+	state->last = QDate::fromString(to, "dd-MM-yyyy");
+	state->file.setFileName(path);
+
+	if(!state->day.isValid() || !state->last.isValid() || !state->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return finish_export(state, true);
+	}
+
+	state->file.write(Record_rows::header(state->format));
+	export_records_page(state);
+}
+
+void Firebase::export_records_page(const std::shared_ptr<Export_state> & state) noexcept {
+
+	if(state->day > state->last) {
+		return finish_export(state, false);
+	}
+
+	auto query = site_collection(db(), state->warehouse, "daily_record").Document(normalize_date(state->day.toString("dd-MM-yyyy")))
+		.Collection("records").OrderBy(FieldPath::DocumentId()).Limit(EXPORT_PAGE_SIZE);
+
+	if(state->cursor.is_valid()) {
+		query = query.StartAfter(state->cursor);
+	}
+
+	query.Get().OnCompletion([this, state](const Future<QuerySnapshot> & future) {
+
+		if(future.error() != Error::kErrorOk) {
+			return safe_emit([this, state]() {
+				finish_export(state, true);
+			});
+		}
+
+		const auto docs = future.result()->documents();
+		QByteArray rows;
+
+		for(const auto & doc : docs) {
+			rows += Record_rows::encode(decode_record(doc, doc.id()), state->format);
+		}
+
+		// a short page is the day's last
+		const auto cursor = docs.size() == EXPORT_PAGE_SIZE ? docs.back() : DocumentSnapshot();
+
+		safe_emit([this, state, rows, cursor, count = static_cast<qint64>(docs.size())]() {
+
+			if(state->file.write(rows) != rows.size()) {
+				return finish_export(state, true);
+			}
+
+			state->written += count;
+			state->cursor = cursor;
+
+			if(!cursor.is_valid()) {
+				state->day = state->day.addDays(1);
+			}
+
+			QVariantMap progress;
+			progress["date"] = state->day.toString("dd-MM-yyyy");
+			progress["written"] = state->written;
+
+			emit exportRecordsProgress(progress);
+			export_records_page(state);
+		});
+	});
+}
+
+void Firebase::finish_export(const std::shared_ptr<Export_state> & state, const bool error) noexcept {
+	const bool flushed = !state->file.isOpen() || state->file.flush();
+	state->file.close();
+
+	QVariantMap response;
+	response["error"] = error || !flushed;
+	response["path"] = state->file.fileName();
+	response["written"] = state->written;
+
+	emit exportRecordsResponse(response);
+}
+
+struct Firebase::Import_state {
+	QFile file;
+	std::unique_ptr<Record_rows> rows;
+	// hash of the file's contents, names the chunk markers so a rerun of the same file resumes
+	std::string import_id;
+	std::string warehouse;
+	int64_t next_chunk = 0;
+	int in_flight = 0;
+	bool read_all = false;
+	qint64 committed = 0;
+	qint64 skipped = 0;
+	qint64 failed = 0;
+	QStringList invalid;
+};
+
+void Firebase::import_records(const QString & path) noexcept {
+	auto state = std::make_shared<Import_state>();
+	state->file.setFileName(path);
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+
+	if(!state->file.open(QIODevice::ReadOnly) || !hash.addData(&state->file) || !state->file.seek(0)) {
+		QVariantMap response;
+		response["error"] = true;
+		response["reason"] = "cannot read " + path;
+
+		return emit importRecordsResponse(response);
+	}
+
+	// the same file imported into another site is a separate import
+	state->warehouse = warehouse_;
+	state->import_id = hash.result().toHex().toStdString() + (warehouse_ == DEFAULT_WAREHOUSE ? "" : "_" + warehouse_);
+	state->rows = std::make_unique<Record_rows>(&state->file, Record_rows::format_of(path));
+
+	import_chunks(state);
+}
+
+void Firebase::import_chunks(const std::shared_ptr<Import_state> & state) noexcept {
+
+	while(state->in_flight < IMPORT_BATCHES_IN_FLIGHT && !state->read_all) {
+		std::vector<Record_rows::Row> rows;
+
+		// a fixed number of rows per chunk, so a rerun cuts the same chunks
+		while(rows.size() < MAX_COALESCED_ENTRIES) {
+			Record_rows::Row row;
+			QString error;
+
+			if(!state->rows->next(row, error)) {
+				state->read_all = true;
+				break;
+			}
+
+			if(!error.isEmpty()) {
+				state->invalid.append(QString("line %1: %2").arg(state->rows->line()).arg(error));
+				continue;
+			}
+
+			if(row.record.doc_id.isEmpty()) {
+				row.record.doc_id = QCryptographicHash::hash(QByteArray::fromStdString(state->import_id) + QByteArray::number(state->rows->line()),
+					QCryptographicHash::Sha1).toHex().left(20);
+			}
+
+			rows.push_back(std::move(row));
+		}
+
+		if(rows.empty()) {
+			continue;
+		}
+
+		const auto chunk = state->next_chunk++;
+		const auto marker = db()->Collection("imports").Document(state->import_id).Collection("chunks").Document(std::to_string(chunk));
+		const auto shard_salt = QRandomGenerator::global()->generate();
+		auto added = std::make_shared<QList<Record>>();
+
+		++state->in_flight;
+
+		auto fut = db()->RunTransaction([this, rows, chunk, marker, added, shards = counter_shards_, shard_salt, warehouse = state->warehouse](Transaction & transaction,
+			std::string & error_message) -> Error {
+			Error error = Error::kErrorOk;
+			added->clear();
+
+			// the marker commits with the chunk, so its presence means an earlier run already applied it
+			const bool applied = transaction.Get(marker, &error, &error_message).exists();
+
+			if(error != Error::kErrorOk || applied) {
+				return error;
+			}
+
+			std::map<std::string, User_dates> users;
+			std::vector<const Record_rows::Row *> missing;
+			std::set<QString> seen;
+			// users are shared by the sites, the customer may have the record from an import into another one
+			std::set<QString> with_user;
+
+			for(const auto & row : rows) {
+				// an exported file carries the docIDs of records already in the store, those are left as they are
+				const auto refs = record_refs(warehouse, row.record.date, row.record.name, row.record.doc_id.toStdString(), shards, shard_salt);
+				const auto existing = transaction.Get(refs.daily_record, &error, &error_message);
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+
+				if(existing.exists() || !seen.insert(row.record.doc_id).second) {
+					continue;
+				}
+
+				missing.push_back(&row);
+
+				const bool user_has = transaction.Get(refs.user_record, &error, &error_message).exists();
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+
+				if(user_has) {
+					with_user.insert(row.record.doc_id);
+					continue;
+				}
+
+				const auto & user_doc = refs.user_doc;
+
+				if(users.count(user_doc.path())) {
+					continue;
+				}
+
+				const auto snapshot = transaction.Get(user_doc, &error, &error_message);
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+
+				users[user_doc.path()] = user_dates(snapshot);
+			}
+
+			Coalesced_writes writes;
+
+			for(const auto * row : missing) {
+				const auto refs = record_refs(warehouse, row->record.date, row->record.name, row->record.doc_id.toStdString(), shards, shard_salt);
+
+				const bool to_user = !with_user.count(row->record.doc_id);
+
+				stage_add_record(writes, refs, row->record, row->phone, to_user);
+
+				if(to_user) {
+					stage_user_dates(writes, refs.user_doc, users[refs.user_doc.path()], row->record);
+				}
+
+				added->append(row->record);
+			}
+
+			writes.set(marker, {
+				{"chunk", FieldValue::Integer(chunk)},
+				{"records", FieldValue::Integer(static_cast<int64_t>(rows.size()))},
+				{"committedAt", FieldValue::ServerTimestamp()}
+			});
+
+			writes.apply(transaction);
+			return Error::kErrorOk;
+		});
+
+		QList<Record> records;
+
+		for(const auto & row : rows) {
+			records.append(row.record);
+		}
+
+		fut.OnCompletion([this, state, records, added](const Future<void> & future) {
+			const bool committed = future.error() == Error::kErrorOk;
+
+			if(!committed) {
+				qWarning() << "Import batch failed:" << future.error_message();
+			}
+
+			safe_emit([this, state, records, committed, added = *added]() {
+				on_import_chunk_committed(state, records, added, committed);
+			});
+		});
+	}
+
+	if(!state->read_all || state->in_flight != 0) {
+		return;
+	}
+
+	QVariantMap response;
+	response["error"] = state->failed != 0;
+	response["committed"] = state->committed;
+	response["skipped"] = state->skipped;
+	response["failed"] = state->failed;
+	response["invalid"] = state->invalid;
+
+	emit importRecordsResponse(response);
+}
+
+void Firebase::on_import_chunk_committed(const std::shared_ptr<Import_state> & state, const QList<Record> & records, const QList<Record> & added,
+	const bool committed) noexcept {
+	--state->in_flight;
+
+	if(!committed) {
+		// left without a marker, the next run commits it
+		state->failed += records.size();
+	} else {
+		state->committed += added.size();
+		state->skipped += records.size() - added.size();
+
+		for(const auto & record : added) {
+			invalidate_reads(record.date, record.name);
+
+			if(range_index_.loaded() && state->warehouse == warehouse_) {
+				Range_index::Totals delta;
+				delta.bale_sold = record.bale_sold;
+				delta.weight_sold = record.weight_sold;
+				delta.amount = record.amount;
+				delta.received_amount = record.received_amount;
+
+				range_index_.add(normalize_date(record.date), delta);
+			}
+		}
+	}
+
+	QVariantMap progress;
+	progress["committed"] = state->committed;
+	progress["skipped"] = state->skipped;
+	progress["failed"] = state->failed;
+	progress["invalid"] = static_cast<int>(state->invalid.size());
+
+	emit importRecordsProgress(progress);
+	import_chunks(state);
+}
+
+void Firebase::delete_record(const QVariantMap & data) noexcept {
+	const auto span = tracer_.start("delete_record");
+	const auto doc_id = data["docID"].toString();
+
+	QVariantMap response;
+	response["docID"] = doc_id;
+
+	// a record deletes from the site it was shown from
+	auto entry = data;
+
+	if(!entry.contains("warehouse")) {
+		entry["warehouse"] = QString::fromStdString(warehouse_);
+	}
+
+	const bool valid = !doc_id.isEmpty() && valid_date(data["date"].toString());
+	const bool journaled = valid && journal_.append("delete", doc_id, entry);
+
+	// the journal fsync stands in for the store round trip, the commit is traced as replay_journal
+	span.mark(Latency_tracer::Completed);
+
+	if(!journaled) {
+		response["error"] = true;
+
+		if(!valid) {
+			response["message"] = "docID and a DD-MM-YYYY date are required";
+		}
+
+		return traced_emit(span, [this, response]() {
+			emit deleteRecordResponse(response);
+		});
+	}
+
+	invalidate_reads(data["date"].toString(), data["name"].toString());
+
+	response["error"] = false;
+	response["pending"] = true;
+
+	response["totalAmountDelta"] = -data["amount"].toInt();
+	response["totalReceivedAmountDelta"] = -data["receivedAmount"].toInt();
+	response["totalBaleSoldDelta"] = -data["baleSold"].toInt();
+	response["totalWeightSoldDelta"] = -data["weightSold"].toInt();
+
+	response["baleAmountDelta"] = data["baleSold"].toInt();
+	response["baleWeightDelta"] = data["weightSold"].toInt();
+
+	traced_emit(span, [this, response]() {
+		emit deleteRecordResponse(response);
+		emit journalChanged();
+	});
+
+	schedule_replay();
+}
+
+void Firebase::cleanup_empty_user(const QString & name) noexcept {
+	auto user_ref = db()->Collection("users").Document(normalize_name(name).toStdString());
+
+	user_ref.Get().OnCompletion([this, user_ref](const auto & future) {
+
+		if(future.error() != Error::kErrorOk) {
+			return;
+		}
+
+		const auto * doc = future.result();
+
+		if(!doc || !doc->exists()) {
+			return;
+		}
+
+		const auto record_count = doc->Get("recordCount");
+
+		if(record_count.is_integer() && record_count.integer_value() > 0) {
+			return;
+		}
+
+		// users created before recordCount existed can read low, so confirm against the records themselves
+		user_ref.Collection("records").Limit(1).Get().OnCompletion([this, user_ref, record_count](const auto & future) {
+
+			if(future.error() != Error::kErrorOk || !future.result()->empty()) {
+				return;
+			}
+
+			// a sale recorded for this customer in the meantime changes the counter and keeps the document
+			db()->RunTransaction([user_ref, record_count](Transaction & transaction, std::string & error_message) -> Error {
+				Error error = Error::kErrorOk;
+				const auto doc = transaction.Get(user_ref, &error, &error_message);
+
+				if(error != Error::kErrorOk) {
+					return error;
+				}
+
+				if(doc.exists() && doc.Get("recordCount") == record_count) {
+					transaction.Delete(user_ref);
+				}
+
+				return Error::kErrorOk;
+			});
+		});
+	});
+}
+
+void Firebase::sweep_users() noexcept {
+	auto users_fut = db()->Collection("users").Get();
+
+	users_fut.OnCompletion([this](const auto & future) {
+
+		if(future.error() != Error::kErrorOk) {
+			QVariantMap response;
+			response["error"] = true;
+
+			return safe_emit([this, response]() {
+				emit sweepUsersResponse(response);
+			});
+		}
+
+		const auto & users = future.result()->documents();
+
+		struct Progress {
+			std::atomic<size_t> remaining;
+			std::atomic<int> deleted{0};
+			std::atomic<bool> failed{false};
+		};
+
+		auto progress = std::make_shared<Progress>();
+		progress->remaining = users.size();
+
+		const auto finish = [this, progress]() {
+			QVariantMap response;
+			response["error"] = progress->failed.load();
+			response["deleted"] = progress->deleted.load();
+
+			safe_emit([this, response]() {
+				emit sweepUsersResponse(response);
+			});
+		};
+
+		if(users.empty()) {
+			return finish();
+		}
+
+		for(const auto & user_doc : users) {
+			auto count_fut = user_doc.reference().Collection("records").Count().Get(AggregateSource::kServer);
+
+			count_fut.OnCompletion([user_ref = user_doc.reference(), progress, finish](const auto & future) mutable {
+
+				if(future.error() != Error::kErrorOk) {
+					progress->failed = true;
+				} else if(const auto count = future.result()->count(); count == 0) {
+					user_ref.Delete();
+					++progress->deleted;
+				} else {
+					user_ref.Set({{"recordCount", FieldValue::Integer(count)}}, SetOptions::Merge());
+				}
+
+				if(--progress->remaining == 0) {
+					finish();
+				}
+			});
+		}
+	});
+}
+
+void Firebase::backfill_user_months() noexcept {
+	auto users_fut = db()->Collection("users").Get();
+
+	users_fut.OnCompletion([this](const Future<QuerySnapshot> & future) {
+
+		if(future.error() != Error::kErrorOk) {
+			QVariantMap response;
+			response["error"] = true;
+
+			return safe_emit([this, response]() {
+				emit backfillUserMonthsResponse(response);
+			});
+		}
+
+		const auto users = future.result()->documents();
+
+		struct Progress {
+			std::atomic<size_t> remaining;
+			std::atomic<int> months{0};
+			std::atomic<bool> failed{false};
+		};
+
+		auto progress = std::make_shared<Progress>();
+		progress->remaining = users.size();
+
+		const auto finish = [this, progress]() {
+			QVariantMap response;
+			response["error"] = progress->failed.load();
+			response["months"] = progress->months.load();
+
+			safe_emit([this, response]() {
+				reads_.clear();
+				emit backfillUserMonthsResponse(response);
+			});
+		};
+
+		const auto settle = [progress, finish](const bool failed) {
+
+			if(failed) {
+				progress->failed = true;
+			}
+
+			if(--progress->remaining == 0) {
+				finish();
+			}
+		};
+
+		if(users.empty()) {
+			return finish();
+		}
+
+		for(const auto & user : users) {
+
+			backfill_user_buckets(user, [progress, settle](const bool failed, const int months) {
+				progress->months += months;
+				settle(failed);
+			});
+		}
+	});
+}
+
+void Firebase::backfill_user_buckets(const DocumentSnapshot & user, std::function<void(bool, int)> done, const int attempt) noexcept {
+	const auto user_ref = user.reference();
+	const auto before = user.GetData();
+
+	// the buckets are read before the records, so an entry the records no longer have is gone for good
+	user_ref.Collection("months").Get().OnCompletion([this, user_ref, before, done, attempt](const Future<QuerySnapshot> & future) {
+
+		if(future.error() != Error::kErrorOk) {
+			return done(true, 0);
+		}
+
+		std::map<std::string, std::set<std::string>> stored;
+
+		for(const auto & doc : future.result()->documents()) {
+			auto & keys = stored[doc.id()];
+
+			for(const auto & [key, value] : doc.Get("entries").map_value()) {
+				keys.insert(key);
+			}
+		}
+
+		user_ref.Collection("records").Get().OnCompletion([this, user_ref, before, done, attempt, stored](const Future<QuerySnapshot> & future) {
+
+			if(future.error() != Error::kErrorOk) {
+				return done(true, 0);
+			}
+
+			// entry by entry, merged like the replay writes them, so a sale landing meanwhile keeps its own
+			Coalesced_writes writes;
+			std::map<std::string, std::set<std::string>> found;
+			// the days the aging report reads, customers from before it have neither
+			User_dates dates;
+
+			for(const auto & doc : future.result()->documents()) {
+				const auto record = decode_record(doc, doc.id());
+				const auto day = normalize_date(record.date);
+				const auto month = day.substr(0, 6);
+
+				writes.set_map_entry(user_ref.Collection("months").Document(month), "entries", doc.id(), bucket_entry(record));
+				found[month].insert(doc.id());
+
+				if(dates.first_sale.empty() || day < dates.first_sale) {
+					dates.first_sale = day;
+				}
+
+				if(record.received_amount > 0 && day > dates.last_payment) {
+					dates.last_payment = day;
+				}
+			}
+
+			for(const auto & [month, keys] : stored) {
+				const auto bucket = user_ref.Collection("months").Document(month);
+
+				// a month whose records are all gone
+				if(!found.count(month)) {
+					writes.remove(bucket);
+					continue;
+				}
+
+				for(const auto & key : keys) {
+
+					if(!found[month].count(key)) {
+						writes.set_map_entry(bucket, "entries", key, FieldValue::Delete());
+					}
+				}
+			}
+
+			auto batch = db()->batch();
+			writes.apply(batch);
+
+			const auto months = static_cast<int>(found.size());
+
+			batch.Commit().OnCompletion([this, user_ref, before, done, attempt, months, dates](const Future<void> & future) {
+
+				if(future.error() != Error::kErrorOk) {
+					return done(true, 0);
+				}
+
+				auto latest = std::make_shared<std::optional<DocumentSnapshot>>();
+
+				// every sale or deletion moves the customer's totals, so an unchanged customer document means
+				// the buckets hold exactly their records. the history only switches to them then
+				db()->RunTransaction([user_ref, before, latest, dates](Transaction & transaction, std::string & error_message) -> Error {
+					Error error = Error::kErrorOk;
+					const auto user = transaction.Get(user_ref, &error, &error_message);
+
+					if(error != Error::kErrorOk) {
+						return error;
+					}
+
+					latest->reset();
+
+					if(user.GetData() != before) {
+						*latest = user;
+						return Error::kErrorOk;
+					}
+
+					MapFieldValue fields = {{"monthsComplete", FieldValue::Boolean(true)}};
+
+					if(!dates.first_sale.empty()) {
+						fields["firstSaleDay"] = FieldValue::String(dates.first_sale);
+					}
+
+					if(!dates.last_payment.empty()) {
+						fields["lastPaymentDay"] = FieldValue::String(dates.last_payment);
+					}
+
+					transaction.Set(user_ref, fields, SetOptions::Merge());
+					return Error::kErrorOk;
+
+				}).OnCompletion([this, done, attempt, months, latest](const Future<void> & future) {
+
+					if(future.error() != Error::kErrorOk) {
+						return done(true, 0);
+					}
+
+					if(!latest->has_value()) {
+						return done(false, months);
+					}
+
+					if(attempt == BACKFILL_USER_ATTEMPTS) {
+						qWarning() << "Gave up on the month buckets of" << QString::fromStdString(latest->value().id()) << "while sales kept landing";
+						return done(true, 0);
+					}
+
+					backfill_user_buckets(latest->value(), done, attempt + 1);
+				});
+			});
+		});
+	});
+}
+
+QString Firebase::best_customer(const QString & query) const noexcept {
+	const auto matches = customer_index_.rank(query, 1);
+	return matches.empty() ? QString() : matches.front().customer.name;
+}
+
+void Firebase::get_users(const QString & prefix, const int limit) noexcept {
+
+	if(customer_index_.loaded()) {
+		return customer_index_.search(prefix, limit);
+	}
+
+	// the listener has not delivered its first snapshot yet
+	query_users(prefix, limit);
+}
+
+void Firebase::query_users(const QString & prefix, const int limit) noexcept {
+	const auto span = tracer_.start("get_users");
+	// normalize the prefix
+	const auto normalized_prefix = normalize_name(prefix);
+
+	// now search the "users" collection for documents that start with the prefix
+	auto users_ref = db()->Collection("users");
+
+	auto query = users_ref.WhereGreaterThanOrEqualTo(FieldPath::DocumentId(), FieldValue::String(normalized_prefix.toStdString()))
+		.WhereLessThan(FieldPath::DocumentId(), FieldValue::String((normalized_prefix + "\uf8ff").toStdString()))
+		.Limit(limit);
+
+	auto users_fut = query.Get();
+
+	users_fut.OnCompletion([this, span](const auto & future) {
+		span.mark(Latency_tracer::Completed);
+		QVariantMap response;
+
+		if(future.error() != Error::kErrorOk) {
+			response["error"] = true;
+
+			return traced_emit(span, [this, response]() {
+				emit getUsersResponse(response);
+			});
+		}
+
+		const auto & snapshot = *future.result();
+
+		if(snapshot.empty()) {
+			response["error"] = false;
+			response["empty"] = true;
+
+			return traced_emit(span, [this, response]() {
+				emit getUsersResponse(response);
+			});
+		}
+
+		QVariantList users_list;
+
+		for(const auto & doc : snapshot.documents()) {
+			QVariantMap user_data;
+
+			user_data["name"] = QString::fromStdString(doc.Get("name").string_value());
+			user_data["phone"] = QString::fromStdString(doc.Get("phone").string_value());
+
+			users_list.append(user_data);
+		}
+
+		response["empty"] = false;
+		response["error"] = false;
+		response["users"] = users_list;
+
+		traced_emit(span, [this, response]() {
+			emit getUsersResponse(response);
+		});
+	});
+}
+
+void Firebase::get_top_debtors(const int n) noexcept {
+	const auto span = tracer_.start("get_top_debtors");
+
+	auto fut = db()->Collection("users").OrderBy("debt", Query::Direction::kDescending).Limit(std::max(n, 1)).Get();
+
+	fut.OnCompletion([this, span](const Future<QuerySnapshot> & future) {
+		span.mark(Latency_tracer::Completed);
+		QVariantMap response;
+
+		if(future.error() != Error::kErrorOk) {
+			response["error"] = true;
+
+			return traced_emit(span, [this, response]() {
+				emit getTopDebtorsResponse(response);
+			});
+		}
+
+		QVariantList debtors;
+
+		for(const auto & doc : future.result()->documents()) {
+			const auto debt = doc.Get("debt").integer_value();
+
+			// the tail of a short list is customers who owe nothing
+			if(debt <= 0) {
+				break;
+			}
+
+			const auto last_payment = QDate::fromString(QString::fromStdString(doc.Get("lastPaymentDay").string_value()), "yyyyMMdd");
+
+			QVariantMap debtor;
+			debtor["name"] = QString::fromStdString(doc.Get("name").string_value());
+			debtor["phone"] = QString::fromStdString(doc.Get("phone").string_value());
+			debtor["debt"] = static_cast<qint64>(debt);
+			debtor["lastPayment"] = last_payment.isValid() ? last_payment.toString("dd-MM-yyyy") : QString();
+
+			debtors.append(debtor);
+		}
+
+		response["error"] = false;
+		response["debtors"] = debtors;
+
+		traced_emit(span, [this, response]() {
+			emit getTopDebtorsResponse(response);
+		});
+	});
+}
+
+void Firebase::get_debt_aging() noexcept {
+	const auto span = tracer_.start("get_debt_aging");
+
+	auto fut = db()->Collection("users").WhereGreaterThan("debt", FieldValue::Integer(0)).Get();
+
+	fut.OnCompletion([this, span](const Future<QuerySnapshot> & future) {
+		span.mark(Latency_tracer::Completed);
+		QVariantMap response;
+
+		if(future.error() != Error::kErrorOk) {
+			response["error"] = true;
+
+			return traced_emit(span, [this, response]() {
+				emit getDebtAgingResponse(response);
+			});
+		}
+
+		struct Bucket {
+			QString label;
+			int customers = 0;
+			qint64 debt = 0;
+		};
+
+		// the last one holds customers last written before their dates were kept
+		std::array<Bucket, 4> buckets = {{{"0-30 days"}, {"31-60 days"}, {"60+ days"}, {"Undated"}}};
+		const auto today = QDate::currentDate();
+		qint64 total_debt = 0;
+
+		for(const auto & doc : future.result()->documents()) {
+			auto since = doc.Get("lastPaymentDay").string_value();
+
+			if(since.empty()) {
+				since = doc.Get("firstSaleDay").string_value();
+			}
+
+			const auto date = QDate::fromString(QString::fromStdString(since), "yyyyMMdd");
+			const auto days = date.isValid() ? date.daysTo(today) : -1;
+			auto & bucket = days < 0 ? buckets[3] : days <= 30 ? buckets[0] : days <= 60 ? buckets[1] : buckets[2];
+
+			const auto debt = doc.Get("debt").integer_value();
+			++bucket.customers;
+			bucket.debt += debt;
+			total_debt += debt;
+		}
+
+		QVariantList rows;
+
+		for(const auto & bucket : buckets) {
+
+			if(&bucket == &buckets[3] && bucket.customers == 0) {
+				continue;
+			}
+
+			rows.append(QVariantMap{{"label", bucket.label}, {"customers", bucket.customers}, {"debt", bucket.debt}});
+		}
+
+		response["error"] = false;
+		response["buckets"] = rows;
+		response["totalDebt"] = total_debt;
+
+		traced_emit(span, [this, response]() {
+			emit getDebtAgingResponse(response);
+		});
+	});
+}
+
+struct Firebase::Analytics_load {
+	std::string warehouse;
+	int generation = 0;
+	QDate next;
+	QDate last;
+	int in_flight = 0;
+	int days = 0;
+	bool failed = false;
+	QElapsedTimer clock;
+};
+
+void Firebase::load_analytics(const QString & from, const QString & to) noexcept {
+	auto load = std::make_shared<Analytics_load>();
+
+	load->warehouse = warehouse_;
+	load->generation = ++analytics_generation_;
+	load->next = QDate::fromString(from, "dd-MM-yyyy");
+	load->last = QDate::fromString(to, "dd-MM-yyyy");
+	load->clock.start();
+
+	analytics_.clear();
+
+	if(!load->next.isValid() || !load->last.isValid() || load->next > load->last) {
+		QVariantMap response;
+		response["error"] = true;
+
+		return emit loadAnalyticsResponse(response);
+	}
+
+	load_analytics_days(load);
+}
+
+void Firebase::load_analytics_days(const std::shared_ptr<Analytics_load> & load) noexcept {
+
+	while(!load->failed && load->in_flight < ANALYTICS_DAYS_IN_FLIGHT && load->next <= load->last) {
+		const auto day = normalize_date(load->next.toString("dd-MM-yyyy"));
+
+		load->next = load->next.addDays(1);
+		++load->in_flight;
+
+		site_collection(db(), load->warehouse, "daily_record").Document(day).Collection("records").Get().OnCompletion([this, load](const Future<QuerySnapshot> & future) {
+			const bool error = future.error() != Error::kErrorOk;
+			QList<Record> records;
+
+			if(!error) {
+
+				for(const auto & doc : future.result()->documents()) {
+					records.append(decode_record(doc, doc.id()));
+				}
+			}
+
+			safe_emit([this, load, records, error]() {
+				on_analytics_day(load, records, error);
+			});
+		});
+	}
+}
+
+void Firebase::on_analytics_day(const std::shared_ptr<Analytics_load> & load, const QList<Record> & records, const bool error) noexcept {
+	--load->in_flight;
 
-	if(!db_) {
-		qWarning() << "Failed to get Firestore instance.";
+	// a newer load cleared the store
+	if(load->generation != analytics_generation_) {
 		return;
 	}
-}
 
-void Firebase::get_bale() noexcept {
+	if(error) {
+		load->failed = true;
+	} else {
+		analytics_.reserve(analytics_.size() + static_cast<size_t>(records.size()));
 
-	db_->Collection("store").Document("stock").Get().OnCompletion([this](const auto & future) {
+		for(const auto & record : records) {
+			analytics_.append(record);
+		}
 
-		QVariantMap response;
+		++load->days;
+	}
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
+	if(!load->failed && load->next <= load->last) {
+		QVariantMap progress;
+		progress["days"] = load->days;
+		progress["records"] = static_cast<qint64>(analytics_.size());
 
-			return safe_emit([this, response]() {
-				emit getBaleResponse(response);
-			});
-		}
+		emit loadAnalyticsProgress(progress);
+		return load_analytics_days(load);
+	}
 
-		const auto * doc = future.result();
-		const int bale_amount = doc->Get("baleAmount").integer_value();
-		const int bale_weight = doc->Get("baleWeight").integer_value();
+	if(load->in_flight > 0) {
+		return;
+	}
 
-		response["baleAmount"] = bale_amount;
-		response["baleWeight"] = bale_weight;
-		response["error"] = false;
+	// half a range would break down as if it were all of it
+	if(load->failed) {
+		analytics_.clear();
+	}
 
-		return safe_emit([this, response]() {
-			emit getBaleResponse(response);
-		});
+	QVariantMap response;
+	response["error"] = load->failed;
+	response["days"] = load->days;
+	response["records"] = static_cast<qint64>(analytics_.size());
+	response["customers"] = analytics_.customers();
+	response["elapsedMs"] = load->clock.elapsed();
 
-	});
+	emit loadAnalyticsResponse(response);
 }
 
-void Firebase::set_bale(const int bale_amount, const int bale_weight) noexcept {
-
-	auto fut = db_->Collection("store").Document("stock").Set({
-		{"baleAmount", FieldValue::Integer(bale_amount)},
-		{"baleWeight", FieldValue::Integer(bale_weight)}
-	});
+void Firebase::get_analytics(const QVariantMap & query) noexcept {
+	QElapsedTimer clock;
+	clock.start();
 
-	fut.OnCompletion([this, bale_amount, bale_weight](const auto & future) {
-		QVariantMap response;
+	const auto dimension = [](const QString & name) {
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
-		} else {
-			response["error"] = false;
+		if(name == "customer") {
+			return Analytics_store::Dimension::Customer;
 		}
 
-		response["baleAmount"] = bale_amount;
-		response["baleWeight"] = bale_weight;
+		if(name == "month") {
+			return Analytics_store::Dimension::Month;
+		}
 
-		safe_emit([this, response]() {
-			emit this->setBaleResponse(response);
-		});
-	});
-}
+		if(name == "rate") {
+			return Analytics_store::Dimension::Rate;
+		}
 
-void Firebase::add_record(const QVariantMap & data) noexcept {
-	const auto date = data["date"].toString();
-	const auto bale_sold = data["baleSold"].toInt();
-	const auto weight_sold = data["weightSold"].toInt();
-	const auto amount = data["amount"].toInt();
-	const auto name = data["name"].toString();
-	const auto received_amount = data["receivedAmount"].toInt();
-	const auto rate = data["rate"].toFloat();
-	const auto phone = data["phone"].toString();
-
-	const auto record = MapFieldValue{
-		{"date", FieldValue::String(date.toStdString())},
-		{"baleSold", FieldValue::Integer(bale_sold)},
-		{"weightSold", FieldValue::Integer(weight_sold)},
-		{"rate", FieldValue::Double(rate)},
-		{"amount", FieldValue::Integer(amount)},
-		{"receivedAmount", FieldValue::Integer(received_amount)},
-		{"name", FieldValue::String(name.toStdString())}
+		return Analytics_store::Dimension::None;
 	};
 
-	const auto normalized_name = normalize_name(data["name"].toString());
+	const auto first = dimension(query["by"].toString());
+	const auto second = dimension(query["then"].toString());
+	const auto rate_width = query.value("rateWidth", DEFAULT_RATE_WIDTH).toFloat();
+	const auto limit = query.value("limit", 2000).toInt();
 
-	auto daily_doc_ref = db_->Collection("daily_record").Document(normalize_date(date));
-	auto daily_record_ref = daily_doc_ref.Collection("records").Document();
+	QVariantMap response;
+	response["error"] = false;
 
-	const auto daily_record_id = daily_record_ref.id();
+	Analytics_store::Filter filter;
 
-	auto users_ref = db_->Collection("users").Document(normalized_name.toStdString());
-	auto user_record_ref = users_ref.Collection("records").Document(daily_record_id);
-
-	auto bale_ref = db_->Collection("store").Document("stock");
-
-	WriteBatch batch = db_->batch();
-
-	const MapFieldValue bale_data = {
-		{"baleAmount", FieldValue::Increment(-bale_sold)},
-		{"baleWeight", FieldValue::Increment(-weight_sold)}
-	};
+	if(const auto from = query["from"].toString(); !from.isEmpty()) {
+		filter.from_day = Range_index::ordinal(normalize_date(from));
+	}
 
-	const MapFieldValue daily_data = {
-		{"totalBaleSold", FieldValue::Increment(bale_sold)},
-		{"totalWeightSold", FieldValue::Increment(weight_sold)},
-		{"totalAmount", FieldValue::Increment(amount)},
-		{"totalReceivedAmount", FieldValue::Increment(received_amount)},
-	};
+	if(const auto to = query["to"].toString(); !to.isEmpty()) {
+		filter.to_day = Range_index::ordinal(normalize_date(to));
+	}
 
-	const MapFieldValue user_data = {
-		{"name", FieldValue::String(name.toStdString())},
-		{"phone", FieldValue::String(phone.toStdString())},
-		{"totalBaleSold", FieldValue::Increment(bale_sold)},
-		{"totalWeightSold", FieldValue::Increment(weight_sold)},
-		{"totalAmount", FieldValue::Increment(amount)},
-		{"totalReceivedAmount", FieldValue::Increment(received_amount)},
-		{"debt", FieldValue::Increment(amount - received_amount)},
-	};
+	if(const auto name = query["customer"].toString(); !name.isEmpty()) {
+		filter.customer = analytics_.customer_id(name);
 
-	batch.Set(daily_doc_ref, daily_data, SetOptions::Merge());
-	batch.Set(daily_record_ref, record);
-	batch.Set(users_ref, user_data, SetOptions::Merge());
-	batch.Set(user_record_ref, record);
-	batch.Set(bale_ref, bale_data, SetOptions::Merge());
+		if(filter.customer < 0) {
+			response["empty"] = true;
+			return emit getAnalyticsResponse(response);
+		}
+	}
 
-	auto fut = batch.Commit();
+	const auto rows = analytics_.select(filter);
+	auto groups = analytics_.group_by(rows, first, second, rate_width);
 
-	fut.OnCompletion([this, data, daily_record_id](const auto & future) {
-		QVariantMap response = data;
+	std::sort(groups.begin(), groups.end(), [this](const Analytics_store::Group & a, const Analytics_store::Group & b) {
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
-		} else {
-			response["error"] = false;
-			response["docID"] = QString::fromStdString(daily_record_id);
+		if(a.customer != b.customer) {
+			return a.customer < 0 || (b.customer >= 0 && analytics_.customer_name(a.customer) < analytics_.customer_name(b.customer));
 		}
 
-		safe_emit([this, response]() {
-			emit this->addRecordResponse(response);
-		});
+		return a.month != b.month ? a.month < b.month : a.rate_bucket < b.rate_bucket;
 	});
-}
-
-void Firebase::get_daily_records(const QString & date) noexcept {
-	auto doc_ref = db_->Collection("daily_record").Document(normalize_date(date));
-	auto doc_fut = doc_ref.Get();
 
-	doc_fut.OnCompletion([this, doc_ref](const auto & future) {
-		QVariantMap response;
+	QVariantList breakdown;
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
+	for(const auto & group : groups) {
 
-			return safe_emit([this, response]() {
-				emit getDailyRecordsResponseMetadata(response);
-			});
+		if(breakdown.size() == limit) {
+			break;
 		}
 
-		const auto * doc = future.result();
-
-		if(!doc || !doc->exists()) {
-			response["empty"] = true;
+		QVariantMap row;
 
-			return safe_emit([this, response]() {
-				emit getDailyRecordsResponseMetadata(response);
-			});
+		if(group.customer >= 0) {
+			row["customer"] = analytics_.customer_name(group.customer);
 		}
 
-		response["empty"] = false;
-		response["totalBaleSold"] = static_cast<int>(doc->Get("totalBaleSold").integer_value());
-		response["totalWeightSold"] = static_cast<int>(doc->Get("totalWeightSold").integer_value());
-		response["totalAmount"] = static_cast<int>(doc->Get("totalAmount").integer_value());
-		response["totalReceivedAmount"] = static_cast<int>(doc->Get("totalReceivedAmount").integer_value());
+		if(group.month >= 0) {
+			row["month"] = QString("%1-%2").arg(group.month / 12).arg(group.month % 12 + 1, 2, 10, QChar('0'));
+		}
 
-		safe_emit([this, response]() {
-			emit getDailyRecordsResponseMetadata(response);
-		});
+		if(group.rate_bucket >= 0) {
+			row["rate"] = QString("%1-%2").arg(group.rate_bucket * rate_width).arg((group.rate_bucket + 1) * rate_width);
+		}
 
-		auto records_ref = doc_ref.Collection("records");
-		auto records_fut = records_ref.Get();
+		row["records"] = static_cast<qint64>(group.records);
+		row["baleSold"] = static_cast<qint64>(group.bale_sold);
+		row["weightSold"] = static_cast<qint64>(group.weight_sold);
+		row["amount"] = static_cast<qint64>(group.amount);
+		row["receivedAmount"] = static_cast<qint64>(group.received_amount);
+		row["averageBaleWeight"] = group.bale_sold > 0 ? static_cast<double>(group.weight_sold) / static_cast<double>(group.bale_sold) : 0.0;
 
-		records_fut.OnCompletion([this](const auto & future) {
-			QVariantMap response;
+		breakdown.append(row);
+	}
 
-			if(future.error() != Error::kErrorOk) {
-				response["error"] = true;
-				response["message"] = QString::fromStdString(future.error_message());
+	response["empty"] = groups.empty();
+	response["rows"] = breakdown;
+	response["groups"] = static_cast<qint64>(groups.size());
+	response["truncated"] = static_cast<qsizetype>(groups.size()) > breakdown.size();
+	response["records"] = static_cast<qint64>(rows.size());
+	response["elapsedMs"] = static_cast<double>(clock.nsecsElapsed()) / 1e6;
 
-				return safe_emit([this, response]() {
-					emit getDailyRecordsResponse(response);
-				});
-			}
+	emit getAnalyticsResponse(response);
+}
 
-			const auto * docs = future.result();
+void Firebase::get_monthly_totals(const int month, const int year) noexcept {
+	const auto key = QString::number(year) + QString::number(month).rightJustified(2, '0');
+	const auto read_key = "month:" + key;
 
-			if(!docs || docs->documents().empty()) {
-				response["empty"] = true;
+	if(!reads_.join(read_key)) {
+		return;
+	}
 
-				return safe_emit([this, response]() {
-					emit getDailyRecordsResponse(response);
-				});
-			}
+	const auto span = tracer_.start("get_monthly_totals");
+	const auto revalidation = std::make_shared<Revalidation>();
+	const auto month_ref = site("monthly_totals").Document(key.toStdString());
+	const auto days = site("daily_record");
 
-			response["empty"] = false;
+	const auto to_response = [month, year](const Sharded_counters::Result & result) {
+		auto response = totals_response(result.totals);
+		response["error"] = false;
+		response["month"] = month;
+		response["year"] = year;
+		return response;
+	};
 
-			QJsonArray records_array;
+	Sharded_counters::read(month_ref, TOTAL_FIELDS, [this, revalidation, to_response](const Sharded_counters::Result & result) {
 
-			for(const auto & doc : docs->documents()) {
+		if(result.error || !result.exists) {
+			return;
+		}
 
-				if(!doc.exists()) {
-					continue;
-				}
+		auto response = to_response(result);
+		const QVariant fingerprint = response;
+		response["fresh"] = false;
 
-				QJsonObject record_obj;
+		paint_cached(revalidation, fingerprint, [this, response]() {
+			emit getMonthlyTotalsResponse(response);
+		});
+	}, Source::kCache);
 
-				record_obj["docID"] = QString::fromStdString(doc.id());
-				record_obj["date"] = QString::fromStdString(doc.Get("date").string_value());
-				record_obj["baleSold"] = static_cast<int>(doc.Get("baleSold").integer_value());
-				record_obj["weightSold"] = static_cast<int>(doc.Get("weightSold").integer_value());
-				record_obj["rate"] = static_cast<float>(doc.Get("rate").double_value());
-				record_obj["amount"] = static_cast<int>(doc.Get("amount").integer_value());
-				record_obj["receivedAmount"] = static_cast<int>(doc.Get("receivedAmount").integer_value());
-				record_obj["name"] = QString::fromStdString(doc.Get("name").string_value());
-				records_array.append(record_obj);
-			}
+	Sharded_counters::read(month_ref, TOTAL_FIELDS, [this, span, revalidation, read_key, month, year, days, to_response](const Sharded_counters::Result & result) {
+		span.mark(Latency_tracer::Completed);
 
-			response["records"] = records_array;
-			response["error"] = false;
+		if(result.error) {
+			QVariantMap response;
+			response["error"] = true;
+			response["month"] = month;
+			response["year"] = year;
 
-			safe_emit([this, response]() {
-				emit getDailyRecordsResponse(response);
+			return finish_revalidated(revalidation, read_key, span, false, {}, [this, response]() {
+				emit getMonthlyTotalsResponse(response);
 			});
-		});
-	});
+		}
 
-}
+		// months older than the rollups and not yet backfilled
+		if(!result.exists) {
+			return sum_monthly_daily_records(days, month, year, read_key, span);
+		}
 
-void Firebase::get_user_records(const QString & name) noexcept {
-	const auto normalized_name = normalize_name(name);
+		auto response = to_response(result);
+		const QVariant fingerprint = response;
+		response["fresh"] = true;
 
-	auto user_doc_ref = db_->Collection("users").Document(normalized_name.toStdString());
-	auto user_doc_fut = user_doc_ref.Get();
+		finish_revalidated(revalidation, read_key, span, true, fingerprint, [this, response]() {
+			emit getMonthlyTotalsResponse(response);
+		});
+	}, Source::kServer);
+}
 
-	user_doc_fut.OnCompletion([this, user_doc_ref](const auto & future) {
-		QVariantMap response;
+void Firebase::get_yearly_totals(const int year) noexcept {
+	const auto read_key = "year:" + QString::number(year);
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
+	if(!reads_.join(read_key)) {
+		return;
+	}
 
-			return safe_emit([this, response]() {
-				emit getUserRecordsResponseMetadata(response);
-			});
-		}
+	const auto span = tracer_.start("get_yearly_totals");
 
-		const auto * doc = future.result();
+	Sharded_counters::read(site("yearly_totals").Document(QString::number(year).toStdString()), TOTAL_FIELDS, [this, span, read_key, year](const Sharded_counters::Result & result) {
+		span.mark(Latency_tracer::Completed);
+		QVariantMap response;
 
-		if(!doc || !doc->exists()) {
-			response["empty"] = true;
+		if(result.error) {
+			response["error"] = true;
+			response["year"] = year;
 
-			return safe_emit([this, response]() {
-				emit getUserRecordsResponseMetadata(response);
+			return finish_read(read_key, span, false, [this, response]() {
+				emit getYearlyTotalsResponse(response);
 			});
 		}
 
-		response["name"] = QString::fromStdString(doc->Get("name").string_value());
-		response["phone"] = QString::fromStdString(doc->Get("phone").string_value());
-		response["totalBaleSold"] = static_cast<int>(doc->Get("totalBaleSold").integer_value());
-		response["totalWeightSold"] = static_cast<int>(doc->Get("totalWeightSold").integer_value());
-		response["totalAmount"] = static_cast<int>(doc->Get("totalAmount").integer_value());
-		response["totalReceivedAmount"] = static_cast<int>(doc->Get("totalReceivedAmount").integer_value());
-		response["debt"] = static_cast<int>(doc->Get("debt").integer_value());
+		// a year with nothing recorded, or not yet backfilled, reads as zeros
+		response = totals_response(result.totals);
+		response["error"] = false;
+		response["year"] = year;
 
-		safe_emit([this, response]() {
-			emit getUserRecordsResponseMetadata(response);
+		finish_read(read_key, span, true, [this, response]() {
+			emit getYearlyTotalsResponse(response);
 		});
+	});
+}
 
-		auto user_records_ref = user_doc_ref.Collection("records");
-		auto user_records_fut = user_records_ref.Get();
+QVariantMap Firebase::totals_response(const Sharded_counters::Totals & totals) noexcept {
+	QVariantMap response;
 
-		user_records_fut.OnCompletion([this](const auto & future) {
-			QVariantMap response;
+	for(const auto & field : TOTAL_FIELDS) {
+		const auto it = totals.find(field);
+		response[QString::fromStdString(field)] = static_cast<int>(it == totals.end() ? 0 : it->second);
+	}
 
-			if(future.error() != Error::kErrorOk) {
+	return response;
+}
 
-				response["error"] = true;
-				return safe_emit([this, response]() {
-					emit getUserRecordsResponse(response);
-				});
-			}
+void Firebase::read_daily_totals(std::function<void(const Daily_totals &)> callback) noexcept {
 
-			const auto * docs = future.result();
+	const auto daily = site("daily_record");
+	// the shards collection group spans every site, a shard counts when its counter's collection is this site's
+	const auto daily_path = daily.path();
+	const auto monthly_path = site("monthly_totals").path();
+	const auto yearly_path = site("yearly_totals").path();
 
-			if(!docs || docs->documents().empty()) {
-				response["empty"] = true;
+	daily.Get().OnCompletion([this, callback, daily_path, monthly_path, yearly_path](const Future<QuerySnapshot> & days_future) {
 
-				return safe_emit([this, response]() {
-					emit getUserRecordsResponse(response);
-				});
-			}
+		if(days_future.error() != Error::kErrorOk) {
+			Daily_totals totals;
+			totals.error = true;
+			return callback(totals);
+		}
 
-			response["empty"] = false;
+		// sharded days may have no base document at all, their counts live only in the shards
+		db()->CollectionGroup("shards").Get().OnCompletion([callback, daily_path, monthly_path, yearly_path, days = *days_future.result()](const Future<QuerySnapshot> & future) {
+			Daily_totals totals;
 
-			QList<QJsonValue> records_array;
+			if(future.error() != Error::kErrorOk) {
+				totals.error = true;
+				return callback(totals);
+			}
 
-			for(const auto & doc : docs->documents()) {
+			const auto add_day = [&totals](const std::string & day, const DocumentSnapshot & doc) {
 
-				if(!doc.exists()) {
-					continue;
+				if(day.size() != 8) {
+					return;
 				}
 
-				QJsonObject record_obj;
-
-				record_obj["docID"] = QString::fromStdString(doc.id());
-				record_obj["date"] = QString::fromStdString(doc.Get("date").string_value());
-				record_obj["baleSold"] = static_cast<int>(doc.Get("baleSold").integer_value());
-				record_obj["weightSold"] = static_cast<int>(doc.Get("weightSold").integer_value());
-				record_obj["rate"] = static_cast<float>(doc.Get("rate").double_value());
-				record_obj["amount"] = static_cast<int>(doc.Get("amount").integer_value());
-				record_obj["receivedAmount"] = static_cast<int>(doc.Get("receivedAmount").integer_value());
-				record_obj["name"] = QString::fromStdString(doc.Get("name").string_value());
+				auto & day_totals = totals.days[day];
+				day_totals.bale_sold += doc.Get("totalBaleSold").integer_value();
+				day_totals.weight_sold += doc.Get("totalWeightSold").integer_value();
+				day_totals.amount += doc.Get("totalAmount").integer_value();
+				day_totals.received_amount += doc.Get("totalReceivedAmount").integer_value();
+			};
 
-				records_array.append(record_obj);
+			for(const auto & doc : days.documents()) {
+				add_day(doc.id(), doc);
 			}
 
-			std::sort(records_array.begin(), records_array.end(), [](QJsonValue & a, QJsonValue & b) {
-				return a.toObject()["date"].toString() > b.toObject()["date"].toString();
-			});
-			
-			QJsonArray sorted_array;
+			for(const auto & doc : future.result()->documents()) {
+				const auto counter = doc.reference().Parent().Parent();
+				const auto counters = counter.Parent().path();
 
-			for(const auto & v : records_array) {
-				sorted_array.append(v);
+				if(counters == daily_path) {
+					add_day(counter.id(), doc);
+				} else if(counters == monthly_path || counters == yearly_path) {
+					totals.rollup_shards.push_back(doc.reference());
+				}
 			}
 
-			response["records"] = sorted_array;
-			response["error"] = false;
-
-			return safe_emit([this, response]() {
-				emit getUserRecordsResponse(response);
-			});
+			callback(totals);
 		});
 	});
 }
 
-void Firebase::delete_record(const QVariantMap & data) noexcept {
-	const auto doc_id = data["docID"].toString();
-	const auto date = data["date"].toString();
-
-	const auto bale_sold = data["baleSold"].toInt();
-	const auto weight_sold = data["weightSold"].toInt();
-	const auto amount = data["amount"].toInt();
-	const auto name = normalize_name(data["name"].toString());
-	const auto received_amount = data["receivedAmount"].toInt();
-
-	const auto normalized_name = normalize_name(name);
-
-	auto daily_doc_ref = db_->Collection("daily_record").Document(normalize_date(date));
-	auto daily_record_ref = daily_doc_ref.Collection("records").Document(doc_id.toStdString());
+void Firebase::backfill_rollups() noexcept {
 
-	auto users_ref = db_->Collection("users").Document(normalized_name.toStdString());
-	auto user_record_ref = users_ref.Collection("records").Document(doc_id.toStdString());
-
-	auto bale_ref = db_->Collection("store").Document("stock");
+	read_daily_totals([this, warehouse = warehouse_](const Daily_totals & daily) {
+		QVariantMap response;
 
-	WriteBatch batch = db_->batch();
+		if(daily.error) {
+			response["error"] = true;
 
-	const MapFieldValue bale_data = {
-		{"baleAmount", FieldValue::Increment(bale_sold)},
-		{"baleWeight", FieldValue::Increment(weight_sold)}
-	};
+			return safe_emit([this, response]() {
+				emit backfillRollupsResponse(response);
+			});
+		}
 
-	const MapFieldValue daily_data = {
-		{"totalBaleSold", FieldValue::Increment(-bale_sold)},
-		{"totalWeightSold", FieldValue::Increment(-weight_sold)},
-		{"totalAmount", FieldValue::Increment(-amount)},
-		{"totalReceivedAmount", FieldValue::Increment(-received_amount)}
-	};
+		std::map<std::string, Range_index::Totals> months;
+		std::map<std::string, Range_index::Totals> years;
 
-	const MapFieldValue user_data = {
-		{"totalBaleSold", FieldValue::Increment(-bale_sold)},
-		{"totalWeightSold", FieldValue::Increment(-weight_sold)},
-		{"totalAmount", FieldValue::Increment(-amount)},
-		{"totalReceivedAmount", FieldValue::Increment(-received_amount)},
-		{"debt", FieldValue::Increment(-(amount - received_amount))}
-	};
+		for(const auto & [day, totals] : daily.days) {
+			months[day.substr(0, 6)] += totals;
+			years[day.substr(0, 4)] += totals;
+		}
 
-	batch.Delete(daily_record_ref);
+		std::vector<std::pair<DocumentReference, MapFieldValue>> writes;
 
-	batch.Set(daily_doc_ref, daily_data, SetOptions::Merge());
-	batch.Set(users_ref, user_data, SetOptions::Merge());
+		const auto to_fields = [](const Range_index::Totals & totals) {
+			return MapFieldValue{
+				{"totalBaleSold", FieldValue::Integer(totals.bale_sold)},
+				{"totalWeightSold", FieldValue::Integer(totals.weight_sold)},
+				{"totalAmount", FieldValue::Integer(totals.amount)},
+				{"totalReceivedAmount", FieldValue::Integer(totals.received_amount)}
+			};
+		};
 
-	batch.Delete(user_record_ref);
+		for(const auto & [key, totals] : months) {
+			writes.emplace_back(site_collection(db(), warehouse, "monthly_totals").Document(key), to_fields(totals));
+		}
 
-	batch.Set(bale_ref, bale_data, SetOptions::Merge());
+		for(const auto & [key, totals] : years) {
+			writes.emplace_back(site_collection(db(), warehouse, "yearly_totals").Document(key), to_fields(totals));
+		}
 
-	auto fut = batch.Commit();
+		std::vector<Future<void>> commits;
 
-	fut.OnCompletion([this, data](const auto & future) {
-		QVariantMap response;
+		for(size_t i = 0; i < writes.size(); i += MAX_BATCH_WRITES) {
+			auto batch = db()->batch();
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
+			for(size_t j = i; j < std::min(writes.size(), i + MAX_BATCH_WRITES); ++j) {
+				batch.Set(writes[j].first, writes[j].second);
+			}
 
-			return safe_emit([this, response]() {
-				emit deleteRecordResponse(response);
-			});
+			commits.push_back(batch.Commit());
 		}
 
-		response["error"] = false;
+		// the rollup shards are folded into the rewritten base documents. rollups are derived from
+		// the days alone, so a run that fails halfway is repaired by running it again
+		const auto & stale_shards = daily.rollup_shards;
 
-		response["totalAmountDelta"] = -data["amount"].toInt();
-		response["totalReceivedAmountDelta"] = -data["receivedAmount"].toInt();
-		response["totalBaleSoldDelta"] = -data["baleSold"].toInt();
-		response["totalWeightSoldDelta"] = -data["weightSold"].toInt();
+		for(size_t i = 0; i < stale_shards.size(); i += MAX_BATCH_WRITES) {
+			auto batch = db()->batch();
 
-		response["baleAmountDelta"] = data["baleSold"].toInt();
-		response["baleWeightDelta"] = data["weightSold"].toInt();
-		response["docID"] = data["docID"].toString();
+			for(size_t j = i; j < std::min(stale_shards.size(), i + MAX_BATCH_WRITES); ++j) {
+				batch.Delete(stale_shards[j]);
+			}
 
-		safe_emit([this, response]() {
-			emit deleteRecordResponse(response);
-		});
+			commits.push_back(batch.Commit());
+		}
 
-		cleanup_empty_users();
-	});
-}
+		// the batches are independent, report once the last one settles
+		auto remaining = std::make_shared<std::atomic<size_t>>(commits.size());
+		auto failed = std::make_shared<std::atomic<bool>>(false);
 
-void Firebase::cleanup_empty_users() noexcept {
-	auto users_fut = db_->Collection("users").Get();
+		response["months"] = static_cast<int>(months.size());
+		response["years"] = static_cast<int>(years.size());
 
-	users_fut.OnCompletion([](const auto & future) {
+		if(commits.empty()) {
+			response["error"] = false;
 
-		if(future.error() != Error::kErrorOk) {
-			return;
+			return safe_emit([this, response]() {
+				emit backfillRollupsResponse(response);
+			});
 		}
 
-		auto users_snapshot = future.result();
+		for(auto & commit : commits) {
 
-		for(const auto & user_doc : users_snapshot->documents()) {
-			auto user_records = user_doc.reference().Collection("records");
-			auto records_future = user_records.Get();
+			commit.OnCompletion([this, remaining, failed, response](const Future<void> & future) mutable {
 
-			records_future.OnCompletion([user_ref = user_doc.reference()](const auto & records_future) mutable {
+				if(future.error() != Error::kErrorOk) {
+					*failed = true;
+				}
 
-				if(records_future.error() != Error::kErrorOk) {
+				if(--*remaining != 0) {
 					return;
 				}
 
-				auto records_snapshot = records_future.result();
+				response["error"] = failed->load();
 
-				if(records_snapshot->empty()) {
-					user_ref.Delete();
-				}
+				safe_emit([this, response]() {
+					// every month and year may have been rewritten
+					reads_.clear();
+					emit backfillRollupsResponse(response);
+				});
 			});
 		}
 	});
 }
 
-void Firebase::get_users(const QString & prefix) noexcept {
-	// normalize the prefix
-	const auto normalized_prefix = normalize_name(prefix);
+void Firebase::get_range_totals(const QString & from, const QString & to) noexcept {
+	pending_range_queries_.emplace_back(from, to);
 
-	// now search the "users" collection for documents that start with the prefix
-	auto users_ref = db_->Collection("users");
+	if(range_index_.loaded()) {
+		return answer_range_queries();
+	}
 
-	auto query = users_ref.WhereGreaterThanOrEqualTo(FieldPath::DocumentId(), FieldValue::String(normalized_prefix.toStdString()))
-		.WhereLessThan(FieldPath::DocumentId(), FieldValue::String((normalized_prefix + "\uf8ff").toStdString()));
+	load_range_index();
+}
 
-	auto users_fut = query.Get();
+void Firebase::refresh_range_index() noexcept {
+	range_index_ = Range_index();
+	load_range_index();
+}
 
-	users_fut.OnCompletion([this](const auto & future) {
-		QVariantMap response;
+void Firebase::load_range_index() noexcept {
 
-		if(future.error() != Error::kErrorOk) {
-			response["error"] = true;
+	if(range_index_loading_) {
+		return;
+	}
 
-			return safe_emit([this, response]() {
-				emit getUsersResponse(response);
-			});
-		}
+	range_index_loading_ = true;
 
-		const auto & snapshot = *future.result();
+	read_daily_totals([this, warehouse = warehouse_](const Daily_totals & daily) {
 
-		if(snapshot.empty()) {
-			response["error"] = false;
-			response["empty"] = true;
+		safe_emit([this, warehouse, daily]() {
+			range_index_loading_ = false;
 
-			return safe_emit([this, response]() {
-				emit getUsersResponse(response);
-			});
-		}
+			// the days belong to a site no longer shown
+			if(warehouse != warehouse_) {
+				return load_range_index();
+			}
 
-		QVariantList users_list;
+			if(daily.error) {
+				return answer_range_queries();
+			}
 
-		for(const auto & doc : snapshot.documents()) {
-			QVariantMap user_data;
+			range_index_.reset(daily.days);
 
-			user_data["name"] = QString::fromStdString(doc.Get("name").string_value());
-			user_data["phone"] = QString::fromStdString(doc.Get("phone").string_value());
+			// commits that landed while the days were being read may or may not be in them,
+			// the next refresh settles that
+			answer_range_queries();
+		});
+	});
+}
 
-			users_list.append(user_data);
+void Firebase::answer_range_queries() noexcept {
+	const auto queries = std::move(pending_range_queries_);
+	pending_range_queries_.clear();
+
+	for(const auto & [from, to] : queries) {
+		QVariantMap response;
+		response["from"] = from;
+		response["to"] = to;
+
+		if(!range_index_.loaded()) {
+			response["error"] = true;
+			emit getRangeTotalsResponse(response);
+			continue;
 		}
 
-		response["empty"] = false;
+		const auto totals = range_index_.sum(normalize_date(from), normalize_date(to));
+
 		response["error"] = false;
-		response["users"] = users_list;
+		response["totalBaleSold"] = static_cast<int>(totals.bale_sold);
+		response["totalWeightSold"] = static_cast<int>(totals.weight_sold);
+		response["totalAmount"] = static_cast<int>(totals.amount);
+		response["totalReceivedAmount"] = static_cast<int>(totals.received_amount);
 
-		safe_emit([this, response]() {
-			emit getUsersResponse(response);
-		});
-	});
+		emit getRangeTotalsResponse(response);
+	}
 }
 
-void Firebase::get_monthly_totals(const int month, const int year) noexcept {
+void Firebase::sum_monthly_daily_records(const CollectionReference & daily_ref, const int month, const int year, const QString & read_key,
+	const Latency_tracer::Span & span) noexcept {
 
 	const auto start_date = [month, year] {
 		// 01-MM-YYYY
@@ -558,20 +3389,21 @@ void Firebase::get_monthly_totals(const int month, const int year) noexcept {
 		return normalize_date(date);
 	}();
 
-	auto daily_ref = db_->Collection("daily_record");
-
 	auto query = daily_ref.WhereGreaterThanOrEqualTo(FieldPath::DocumentId(), FieldValue::String(start_date))
 		.WhereLessThanOrEqualTo(FieldPath::DocumentId(), FieldValue::String((end_date)));
 
 	auto fut = query.Get();
 
-	fut.OnCompletion([this, month, year](const auto & future) {
+	fut.OnCompletion([this, span, read_key, month, year](const auto & future) {
+		span.mark(Latency_tracer::Completed);
 		QVariantMap response;
 
 		if(future.error() != Error::kErrorOk) {
 			response["error"] = true;
+			response["month"] = month;
+			response["year"] = year;
 
-			return safe_emit([this, response]() {
+			return finish_read(read_key, span, false, [this, response]() {
 				emit getMonthlyTotalsResponse(response);
 			});
 		}
@@ -599,7 +3431,7 @@ void Firebase::get_monthly_totals(const int month, const int year) noexcept {
 		response["totalAmount"] = total_amount;
 		response["totalReceivedAmount"] = total_received_amount;
 
-		safe_emit([this, response]() {
+		finish_read(read_key, span, true, [this, response]() {
 			emit getMonthlyTotalsResponse(response);
 		});
 	});
@@ -0,0 +1,128 @@
+#include "fuzzy-match.h"
+
+#include <algorithm>
+
+Fuzzy_pattern::Fuzzy_pattern(const QString & pattern) noexcept : length_(static_cast<int>(std::min<qsizetype>(pattern.size(), MAX_LENGTH))) {
+
+	for(int i = 0; i < length_; ++i) {
+		const char16_t c = pattern[i].unicode();
+		const uint64_t bit = uint64_t(1) << i;
+
+		if(c < ascii_.size()) {
+			ascii_[c] |= bit;
+			continue;
+		}
+
+		const auto it = std::find_if(other_.begin(), other_.end(), [c](const auto & entry) { return entry.first == c; });
+
+		if(it != other_.end()) {
+			it->second |= bit;
+		} else {
+			other_.emplace_back(c, bit);
+		}
+	}
+}
+
+uint64_t Fuzzy_pattern::peq(const char16_t c) const noexcept {
+
+	if(c < ascii_.size()) {
+		return ascii_[c];
+	}
+
+	for(const auto & [other, bits] : other_) {
+
+		if(other == c) {
+			return bits;
+		}
+	}
+
+	return 0;
+}
+
+int Fuzzy_pattern::distance(const QString & text) const noexcept {
+	return run(text, true);
+}
+
+int Fuzzy_pattern::substring_distance(const QString & text) const noexcept {
+	return run(text, false);
+}
+
+// pv/mv hold the vertical deltas of one dp column, +1 and -1. anchored matches against the whole text, where
+// every column starts one higher than the last; otherwise a match may start anywhere and row 0 stays 0
+int Fuzzy_pattern::run(const QString & text, const bool anchored) const noexcept {
+
+	if(length_ == 0) {
+		return anchored ? static_cast<int>(text.size()) : 0;
+	}
+
+	const uint64_t last = uint64_t(1) << (length_ - 1);
+
+	uint64_t pv = ~uint64_t(0);
+	uint64_t mv = 0;
+	int score = length_;
+	int best = score;
+
+	for(const auto ch : text) {
+		const uint64_t eq = peq(ch.unicode());
+		const uint64_t xv = eq | mv;
+		const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+
+		if(ph & last) {
+			++score;
+		} else if(mh & last) {
+			--score;
+		}
+
+		ph = (ph << 1) | (anchored ? 1 : 0);
+		mh <<= 1;
+
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		best = std::min(best, score);
+	}
+
+	return anchored ? score : best;
+}
+
+static std::vector<uint64_t> trigrams(const QString & text) noexcept {
+	// padded so single letters and the ends of the word count too
+	const QString padded = "  " + text + " ";
+
+	std::vector<uint64_t> grams;
+	grams.reserve(static_cast<size_t>(padded.size()));
+
+	for(qsizetype i = 0; i + 3 <= padded.size(); ++i) {
+		grams.push_back(uint64_t(padded[i].unicode()) << 32 | uint64_t(padded[i + 1].unicode()) << 16 | padded[i + 2].unicode());
+	}
+
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+	return grams;
+}
+
+double trigram_similarity(const QString & a, const QString & b) noexcept {
+	const auto a_grams = trigrams(a);
+	const auto b_grams = trigrams(b);
+
+	size_t shared = 0;
+
+	for(auto i = a_grams.begin(), j = b_grams.begin(); i != a_grams.end() && j != b_grams.end();) {
+
+		if(*i < *j) {
+			++i;
+		} else if(*j < *i) {
+			++j;
+		} else {
+			++shared;
+			++i;
+			++j;
+		}
+	}
+
+	return 2.0 * static_cast<double>(shared) / static_cast<double>(a_grams.size() + b_grams.size());
+}
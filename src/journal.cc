@@ -0,0 +1,210 @@
+#include "journal.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <map>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static QJsonObject entry_to_json(const Journal::Entry & entry) {
+	return {
+		{"seq", entry.seq},
+		{"created", entry.created_ms},
+		{"op", entry.op},
+		{"key", entry.key},
+		{"data", QJsonObject::fromVariantMap(entry.data)}
+	};
+}
+
+static QByteArray to_line(const QJsonObject & object) {
+	return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+Journal::Journal(QString path) noexcept : path_(std::move(path)), lock_(path_ + ".lock") {
+}
+
+bool Journal::open() noexcept {
+	QDir().mkpath(QFileInfo(path_).absolutePath());
+
+	// held until the process exits. never stale by age, only a lock whose process is gone is taken over
+	lock_.setStaleLockTime(0);
+
+	if(!lock_.tryLock(0)) {
+		qint64 pid = 0;
+		QString host, application;
+		lock_.getLockInfo(&pid, &host, &application);
+
+		qWarning() << "Journal" << path_ << "is held by" << application << "pid" << pid;
+		return false;
+	}
+
+	std::map<qint64, Entry> entries;
+
+	if(QFile existing(path_); existing.open(QIODevice::ReadOnly)) {
+
+		while(!existing.atEnd()) {
+			const auto line = existing.readLine().trimmed();
+
+			if(line.isEmpty()) {
+				continue;
+			}
+
+			const auto object = QJsonDocument::fromJson(line).object();
+
+			// a write torn by a crash leaves an unparsable tail, it was never acknowledged
+			if(object.isEmpty()) {
+				continue;
+			}
+
+			const auto seq = object["seq"].toInteger();
+			next_seq_ = std::max(next_seq_, seq + 1);
+
+			if(object["done"].toBool()) {
+				entries.erase(seq);
+				continue;
+			}
+
+			Entry entry;
+			entry.seq = seq;
+			entry.created_ms = object["created"].toInteger();
+			entry.op = object["op"].toString();
+			entry.key = object["key"].toString();
+			entry.data = object["data"].toObject().toVariantMap();
+
+			entries[seq] = std::move(entry);
+		}
+	}
+
+	QSaveFile compacted(path_);
+
+	if(!compacted.open(QIODevice::WriteOnly)) {
+		qWarning() << "Failed to compact journal" << path_;
+		return false;
+	}
+
+	for(auto & [seq, entry] : entries) {
+		compacted.write(to_line(entry_to_json(entry)));
+		pending_.push_back(std::move(entry));
+	}
+
+	if(!compacted.commit()) {
+		qWarning() << "Failed to compact journal" << path_;
+		return false;
+	}
+
+	file_.setFileName(path_);
+
+	if(!file_.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		qWarning() << "Failed to open journal" << path_;
+		return false;
+	}
+
+	return true;
+}
+
+bool Journal::append(const QString & op, const QString & key, const QVariantMap & data) noexcept {
+	Entry entry;
+	entry.seq = next_seq_;
+	entry.created_ms = QDateTime::currentMSecsSinceEpoch();
+	entry.op = op;
+	entry.key = key;
+	entry.data = data;
+
+	if(!write(to_line(entry_to_json(entry)))) {
+		return false;
+	}
+
+	++next_seq_;
+	pending_.push_back(std::move(entry));
+
+	return true;
+}
+
+bool Journal::complete(const QList<qint64> & seqs) noexcept {
+	QByteArray lines;
+
+	for(const auto seq : seqs) {
+		const auto it = std::find_if(pending_.begin(), pending_.end(), [seq](const Entry & entry) {
+			return entry.seq == seq;
+		});
+
+		if(it == pending_.end()) {
+			continue;
+		}
+
+		pending_.erase(it);
+		lines += to_line({{"seq", seq}, {"done", true}});
+	}
+
+	// nothing left to replay, start the file over instead of growing it forever
+	if(pending_.empty()) {
+		return file_.resize(0);
+	}
+
+	return lines.isEmpty() || write(lines);
+}
+
+bool Journal::reject(const QList<qint64> & seqs, const QString & reason) noexcept {
+	const QFileInfo info(path_);
+	QFile rejected(info.absolutePath() + "/" + info.completeBaseName() + ".rejected.ndjson");
+
+	if(!rejected.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		qWarning() << "Failed to open" << rejected.fileName();
+		return false;
+	}
+
+	for(const auto seq : seqs) {
+		const auto it = std::find_if(pending_.begin(), pending_.end(), [seq](const Entry & entry) {
+			return entry.seq == seq;
+		});
+
+		if(it == pending_.end()) {
+			continue;
+		}
+
+		auto object = entry_to_json(*it);
+		object["reason"] = reason;
+		object["rejected"] = QDateTime::currentMSecsSinceEpoch();
+
+		if(rejected.write(to_line(object)) < 0) {
+			qWarning() << "Failed to write" << rejected.fileName();
+			return false;
+		}
+	}
+
+	// kept before they leave the journal, a crash in between replays them once more rather than losing them
+	if(!rejected.flush()) {
+		return false;
+	}
+
+	return complete(seqs);
+}
+
+bool Journal::write(const QByteArray & bytes) noexcept {
+
+	if(!file_.isOpen()) {
+		return false;
+	}
+
+	if(file_.write(bytes) != bytes.size() || !file_.flush()) {
+		qWarning() << "Failed to write journal" << path_;
+		return false;
+	}
+
+#ifdef Q_OS_WIN
+	return _commit(file_.handle()) == 0;
+#else
+	return ::fsync(file_.handle()) == 0;
+#endif
+}
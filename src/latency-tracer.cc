@@ -0,0 +1,235 @@
+#include "latency-tracer.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVariantMap>
+
+#include <algorithm>
+
+int Latency_histogram::bucket_of(const int64_t value_us) noexcept {
+
+	if(value_us < SUB_BUCKETS) {
+		return static_cast<int>(std::max<int64_t>(value_us, 0));
+	}
+
+	int msb = 0;
+
+	while((value_us >> (msb + 1)) != 0) {
+		++msb;
+	}
+
+	// the top SUB_BUCKET_BITS + 1 bits pick the bucket within the power of two
+	const auto shift = msb - SUB_BUCKET_BITS;
+	const auto sub_bucket = static_cast<int>(value_us >> shift) - SUB_BUCKETS;
+
+	return std::min((shift + 1) * SUB_BUCKETS + sub_bucket, SUB_BUCKETS * MAGNITUDES - 1);
+}
+
+int64_t Latency_histogram::upper_edge(const int bucket) noexcept {
+	const auto magnitude = bucket / SUB_BUCKETS;
+	const auto sub_bucket = bucket % SUB_BUCKETS;
+
+	if(magnitude == 0) {
+		return sub_bucket;
+	}
+
+	return (static_cast<int64_t>(SUB_BUCKETS + sub_bucket + 1) << (magnitude - 1)) - 1;
+}
+
+void Latency_histogram::record(const int64_t value_us) noexcept {
+	++buckets_[static_cast<size_t>(bucket_of(value_us))];
+	++count_;
+	max_ = std::max(max_, value_us);
+}
+
+int64_t Latency_histogram::percentile(const double p) const noexcept {
+
+	if(count_ == 0) {
+		return 0;
+	}
+
+	const auto rank = std::max<int64_t>(1, static_cast<int64_t>(p * static_cast<double>(count_) + 0.5));
+	int64_t seen = 0;
+
+	for(size_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+		seen += buckets_[bucket];
+
+		if(seen >= rank) {
+			return std::min(upper_edge(static_cast<int>(bucket)), max_);
+		}
+	}
+
+	return max_;
+}
+
+void Latency_tracer::Span::mark(const Stage stage) const noexcept {
+
+	if(!data_) {
+		return;
+	}
+
+	std::lock_guard lock(data_->mutex);
+	data_->at[stage] = Clock::now();
+	data_->marked[stage] = true;
+}
+
+void Latency_tracer::Span::finish() const noexcept {
+
+	if(!data_) {
+		return;
+	}
+
+	std::lock_guard lock(data_->mutex);
+
+	if(data_->finished) {
+		return;
+	}
+
+	data_->finished = true;
+
+	for(int stage = Completed; stage < STAGE_COUNT; ++stage) {
+
+		if(!data_->marked[stage]) {
+			data_->at[stage] = data_->at[stage - 1];
+		}
+	}
+
+	tracer_->record(*data_);
+}
+
+Latency_tracer::Latency_tracer(QObject * parent) noexcept : QObject(parent) {
+}
+
+Latency_tracer::Span Latency_tracer::start(const QString & op) noexcept {
+	Span span;
+	span.tracer_ = this;
+	span.data_ = std::make_shared<Span::Data>();
+	span.data_->op = op;
+	span.data_->at[Issued] = Clock::now();
+	span.data_->marked[Issued] = true;
+
+	std::lock_guard lock(mutex_);
+	span.data_->id = next_id_++;
+
+	return span;
+}
+
+void Latency_tracer::record(const Span::Data & data) noexcept {
+	Finished_span finished;
+	finished.op = data.op;
+	finished.id = data.id;
+
+	for(int stage = 0; stage < STAGE_COUNT; ++stage) {
+		finished.at_us[stage] = std::chrono::duration_cast<std::chrono::microseconds>(data.at[stage] - epoch_).count();
+	}
+
+	const auto & at = finished.at_us;
+
+	std::lock_guard lock(mutex_);
+
+	auto & histograms = histograms_[data.op];
+	histograms[Total].record(at[Handled] - at[Issued]);
+	histograms[Store].record(at[Completed] - at[Issued]);
+	histograms[Callback].record(at[Decoded] - at[Completed]);
+	histograms[Queue].record(at[Emitted] - at[Decoded]);
+	histograms[Handler].record(at[Handled] - at[Emitted]);
+
+	spans_.push_back(std::move(finished));
+
+	if(spans_.size() > MAX_KEPT_SPANS) {
+		spans_.pop_front();
+	}
+}
+
+QVariantList Latency_tracer::summary() const noexcept {
+	const auto to_ms = [](const int64_t us) {
+		return static_cast<double>(us) / 1000.0;
+	};
+
+	QVariantList rows;
+
+	std::lock_guard lock(mutex_);
+
+	for(const auto & [op, histograms] : histograms_) {
+		QVariantMap row;
+
+		row["op"] = op;
+		row["count"] = static_cast<qint64>(histograms[Total].count());
+		row["p50"] = to_ms(histograms[Total].percentile(0.5));
+		row["p99"] = to_ms(histograms[Total].percentile(0.99));
+		row["max"] = to_ms(histograms[Total].max());
+		row["storeP99"] = to_ms(histograms[Store].percentile(0.99));
+		row["callbackP99"] = to_ms(histograms[Callback].percentile(0.99));
+		row["queueP99"] = to_ms(histograms[Queue].percentile(0.99));
+		row["handlerP99"] = to_ms(histograms[Handler].percentile(0.99));
+
+		rows.append(row);
+	}
+
+	return rows;
+}
+
+QString Latency_tracer::dump() const noexcept {
+	const auto dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/traces";
+	QDir().mkpath(dir);
+
+	const auto path_of = [&dir](const int index) {
+		return dir + (index == 0 ? QString("/trace.json") : "/trace." + QString::number(index) + ".json");
+	};
+
+	QFile::remove(path_of(KEPT_DUMPS - 1));
+
+	for(int index = KEPT_DUMPS - 2; index >= 0; --index) {
+		QFile::rename(path_of(index), path_of(index + 1));
+	}
+
+	constexpr const char * PHASE_NAMES[] = {"firestore", "callback", "queue", "qml"};
+
+	QJsonArray events;
+
+	const auto add_slice = [&events](const QString & name, const qint64 id, const qint64 begin_us, const qint64 end_us) {
+		events.append(QJsonObject{{"name", name}, {"cat", "ledger"}, {"ph", "b"}, {"id", id}, {"ts", begin_us}, {"pid", 1}, {"tid", 1}});
+		events.append(QJsonObject{{"name", name}, {"cat", "ledger"}, {"ph", "e"}, {"id", id}, {"ts", end_us}, {"pid", 1}, {"tid", 1}});
+	};
+
+	{
+		std::lock_guard lock(mutex_);
+
+		for(const auto & span : spans_) {
+			// async slices with the span's id nest the phases under the operation even when operations overlap
+			add_slice(span.op, span.id, span.at_us[Issued], span.at_us[Handled]);
+
+			for(int stage = Issued; stage < Handled; ++stage) {
+				add_slice(PHASE_NAMES[stage], span.id, span.at_us[stage], span.at_us[stage + 1]);
+			}
+		}
+	}
+
+	QSaveFile file(path_of(0));
+
+	if(!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "Failed to write trace" << path_of(0);
+		return {};
+	}
+
+	file.write(QJsonDocument(QJsonObject{{"traceEvents", events}, {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact));
+
+	if(!file.commit()) {
+		qWarning() << "Failed to write trace" << path_of(0);
+		return {};
+	}
+
+	return path_of(0);
+}
+
+void Latency_tracer::reset() noexcept {
+	std::lock_guard lock(mutex_);
+	histograms_.clear();
+	spans_.clear();
+}
@@ -5,12 +5,21 @@
 #include <QDebug>
 #include <QResource>
 #include <QEventLoop>
+#include <QCommandLineParser>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <QOpenGLContext>
 #include <QSurfaceFormat>
 
 #include "password-authenticator.h"
 #include "firebase.h"
+#include "rpc-server.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
 
 int main(int argc, char ** argv) {
 
@@ -18,12 +27,82 @@ int main(int argc, char ** argv) {
 	qputenv("QSG_RHI_BACKEND", "opengl");
 #endif
 
-	QGuiApplication app(argc, argv);
+	QElapsedTimer startup_clock;
+	startup_clock.start();
+
+	// known before the application exists, a headless run needs no display
+	const bool headless = std::any_of(argv + 1, argv + argc, [](const char * arg) {
+		return qstrcmp(arg, "--headless") == 0;
+	});
+
+	std::unique_ptr<QCoreApplication> app;
+
+	if(headless) {
+		app = std::make_unique<QCoreApplication>(argc, argv);
+	} else {
+		app = std::make_unique<QGuiApplication>(argc, argv);
+	}
+
+	// the same name as the window's, so a headless run shares its settings and journal. the journal's lock
+	// keeps the two from running at once
+	app->setApplicationName("Bale Ledger");
+	app->setApplicationVersion("1.0.0");
+
+	if(!headless) {
+		QGuiApplication::setApplicationDisplayName("Bale Ledger");
+		QGuiApplication::setWindowIcon(QIcon(":/icons/baleLedgerIcon.ico"));
+	}
+
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	parser.addVersionOption();
+
+	const QCommandLineOption backfill_rollups_option("backfill-rollups", "Rebuild the monthly and yearly totals from the daily records.");
+	parser.addOption(backfill_rollups_option);
+
+	const QCommandLineOption sweep_users_option("sweep-users", "Recount every customer's records and remove customers without any.");
+	parser.addOption(sweep_users_option);
+
+	const QCommandLineOption backfill_user_months_option("backfill-user-months", "Rebuild every customer's month buckets, first sale and last payment days from their records.");
+	parser.addOption(backfill_user_months_option);
+
+	const QCommandLineOption backfill_record_days_option("backfill-record-days", "Add the sortable day field to records written before it existed.");
+	parser.addOption(backfill_record_days_option);
+
+	const QCommandLineOption counter_shards_option("counter-shards", "Spread a counter's writes over several documents, e.g. stock=8.", "counter=shards");
+	parser.addOption(counter_shards_option);
+
+	const QCommandLineOption read_cache_ttl_option("read-cache-ttl", "Answer identical reads from memory for this many ms, 0 to only coalesce them.", "ms");
+	parser.addOption(read_cache_ttl_option);
+
+	const QCommandLineOption local_cache_option("local-cache-mb", "Size of the on-disk cache views are painted from before the server answers.", "megabytes");
+	parser.addOption(local_cache_option);
+
+	const QCommandLineOption prefetch_days_option("prefetch-days", "Read this many days on each side of the shown day ahead of time, 0 to turn it off.", "days");
+	parser.addOption(prefetch_days_option);
+
+	const QCommandLineOption warehouse_option("warehouse", "Open on this site's stock and days, and keep it as the default.", "id");
+	parser.addOption(warehouse_option);
+
+	const QCommandLineOption live_updates_option("live-updates", "Keep the daily view and stock current through snapshot listeners.");
+	parser.addOption(live_updates_option);
+
+	const QCommandLineOption dump_traces_option("dump-traces", "Write the latency trace every minute and on exit, keeping the last few dumps.");
+	parser.addOption(dump_traces_option);
+
+	const QCommandLineOption export_records_option("export-records", "Write the records of a date range to a .csv or .ndjson file.", "from:to:path");
+	parser.addOption(export_records_option);
+
+	const QCommandLineOption import_records_option("import-records", "Add the records of a .csv or .ndjson file, resuming an earlier import of it.", "path");
+	parser.addOption(import_records_option);
 
-	app.setApplicationName("Bale Ledger");
-	app.setApplicationVersion("1.0.0");
-	app.setApplicationDisplayName("Bale Ledger");
-	app.setWindowIcon(QIcon(":/icons/baleLedgerIcon.ico"));
+	const QCommandLineOption headless_option("headless", "Open no window, serve the backend's calls as json-rpc on a local socket instead.");
+	parser.addOption(headless_option);
+
+	const QCommandLineOption rpc_socket_option("rpc-socket", "Name or path of the socket --headless listens on.", "name", "bale-ledger");
+	parser.addOption(rpc_socket_option);
+
+	parser.process(*app);
 
 	// {
 	// 	QQmlApplicationEngine auth_engine;
@@ -33,25 +112,189 @@ int main(int argc, char ** argv) {
 	// 	QObject::connect(&password_auth, &Password_authenticator::password_accepted, &loop, &QEventLoop::quit);
 
 	// 	auth_engine.rootContext()->setContextProperty("password_auth", &password_auth);
-	// 	auth_engine.load(QUrl("qrc:/ui/PasswordDialog.qml"));
+	// 	auth_engine.load(QUrl("qrc:/Ledger/ui/PasswordDialog.qml"));
 	// 	loop.exec();
 	// }
 
-	QQmlApplicationEngine engine;
+	// ms since launch at each step, logged once the first day is on screen and firestore is up. headless
+	// runs wait for firestore alone
+	QStringList startup_phases;
+	int startup_phases_left = headless ? 1 : 3;
+
+	const auto mark_startup = [&](const char * phase, const bool awaited = false) {
+
+		if(startup_phases_left == 0) {
+			return;
+		}
+
+		startup_phases.append(QString("%1 %2 ms").arg(phase).arg(startup_clock.elapsed()));
+
+		if(awaited && --startup_phases_left == 0) {
+			qInfo().noquote() << "Startup:" << startup_phases.join(", ");
+		}
+	};
+
+	mark_startup("app");
+
+	std::optional<QQmlApplicationEngine> engine;
+
+	if(!headless) {
+		engine.emplace();
+	}
+
+	// read when firestore starts, so it goes in before the backend exists
+	if(parser.isSet(local_cache_option)) {
+		Firebase::set_local_cache_size(parser.value(local_cache_option).toInt());
+	}
+
+	if(parser.isSet(warehouse_option)) {
+		Firebase::set_default_warehouse(parser.value(warehouse_option));
+	}
 
 	Firebase firebase;
+	mark_startup("backend");
 
-	engine.rootContext()->setContextProperty("firebase", &firebase);
+	if(firebase.journal_busy()) {
+		qCritical() << "Another Bale Ledger is running on the same journal, quit it first.";
+		return 1;
+	}
 
-	engine.load(QUrl("qrc:/ui/mainWindow.qml"));
+	// a script wants the server's answer, once, rather than a paint from the local cache and then the answer
+	firebase.set_cached_paints(!headless);
 
-	if(!engine.rootObjects().isEmpty()) {
-		auto * window = qobject_cast<QQuickWindow*>(engine.rootObjects().first());
+	QObject::connect(&firebase, &Firebase::firestoreStarted, [&mark_startup]() {
+		mark_startup("firestore", true);
+	});
+
+	QObject::connect(&firebase, &Firebase::getDailyRecordsResponseMetadata, &firebase, [&mark_startup, done = false]() mutable {
+
+		if(!std::exchange(done, true)) {
+			mark_startup("first day", true);
+		}
+	});
+
+	if(engine) {
+		engine->rootContext()->setContextProperty("firebase", &firebase);
+	}
+
+	firebase.set_live_updates(parser.isSet(live_updates_option));
+
+	if(parser.isSet(read_cache_ttl_option)) {
+		firebase.set_read_cache_ttl(parser.value(read_cache_ttl_option).toInt());
+	}
+
+	if(parser.isSet(prefetch_days_option)) {
+		firebase.set_prefetch_days(parser.value(prefetch_days_option).toInt());
+	}
+
+	for(const auto & value : parser.values(counter_shards_option)) {
+		const auto parts = value.split('=');
+
+		if(parts.size() != 2) {
+			qWarning() << "Expected counter=shards, got" << value;
+			continue;
+		}
+
+		firebase.set_counter_shards(parts[0], parts[1].toInt());
+	}
+
+	QTimer trace_timer;
+
+	if(parser.isSet(dump_traces_option)) {
+		QObject::connect(&trace_timer, &QTimer::timeout, firebase.tracer(), &Latency_tracer::dump);
+		QObject::connect(app.get(), &QCoreApplication::aboutToQuit, firebase.tracer(), &Latency_tracer::dump);
+		trace_timer.start(60 * 1000);
+	}
+
+	if(parser.isSet(backfill_rollups_option)) {
+		QObject::connect(&firebase, &Firebase::backfillRollupsResponse, [](const QVariantMap & response) {
+			qInfo() << "Rollup backfill finished:" << response;
+		});
+
+		firebase.backfill_rollups();
+	}
+
+	if(parser.isSet(sweep_users_option)) {
+		QObject::connect(&firebase, &Firebase::sweepUsersResponse, [](const QVariantMap & response) {
+			qInfo() << "User sweep finished:" << response;
+		});
+
+		firebase.sweep_users();
+	}
+
+	if(parser.isSet(backfill_user_months_option)) {
+		QObject::connect(&firebase, &Firebase::backfillUserMonthsResponse, [](const QVariantMap & response) {
+			qInfo() << "Month bucket backfill finished:" << response;
+		});
+
+		firebase.backfill_user_months();
+	}
+
+	if(parser.isSet(backfill_record_days_option)) {
+		QObject::connect(&firebase, &Firebase::backfillRecordDaysResponse, [](const QVariantMap & response) {
+			qInfo() << "Record day backfill finished:" << response;
+		});
+
+		firebase.backfill_record_days();
+	}
+
+	if(parser.isSet(export_records_option)) {
+		const auto parts = parser.value(export_records_option).split(':');
+
+		if(parts.size() < 3) {
+			qWarning() << "Expected from:to:path, got" << parser.value(export_records_option);
+		} else {
+			QObject::connect(&firebase, &Firebase::exportRecordsResponse, [](const QVariantMap & response) {
+				qInfo() << "Record export finished:" << response;
+			});
+
+			// the path may itself contain a colon
+			firebase.export_records(parts[0], parts[1], parts.mid(2).join(':'));
+		}
+	}
+
+	if(parser.isSet(import_records_option)) {
+		QObject::connect(&firebase, &Firebase::importRecordsProgress, [](const QVariantMap & progress) {
+			qInfo() << "Record import:" << progress;
+		});
+
+		QObject::connect(&firebase, &Firebase::importRecordsResponse, [](const QVariantMap & response) {
+			qInfo() << "Record import finished:" << response;
+		});
+
+		firebase.import_records(parser.value(import_records_option));
+	}
+
+	if(headless) {
+		Rpc_server rpc_server(&firebase);
+
+		if(!rpc_server.listen(parser.value(rpc_socket_option))) {
+			qCritical() << "Cannot listen on" << parser.value(rpc_socket_option);
+			return 1;
+		}
+
+		qInfo() << "Serving json-rpc on" << rpc_server.full_name();
+		return app->exec();
+	}
+
+	engine->load(QUrl("qrc:/Ledger/ui/mainWindow.qml"));
+	mark_startup("qml");
+
+	if(!engine->rootObjects().isEmpty()) {
+		auto * window = qobject_cast<QQuickWindow*>(engine->rootObjects().first());
 
 		if(window) {
+			QObject::connect(window, &QQuickWindow::frameSwapped, window, [&mark_startup, done = false]() mutable {
+
+				if(!std::exchange(done, true)) {
+					mark_startup("first frame", true);
+				}
+			});
+
+			firebase.deliver_on_frames(window);
 			window->showMaximized();
 		}
 	}
 
-	return app.exec();
+	return app->exec();
 }
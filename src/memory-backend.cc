@@ -0,0 +1,242 @@
+#include "memory-backend.h"
+
+#include <QTimer>
+#include <QVariantList>
+
+#include <algorithm>
+
+#include "normalize.h"
+
+Memory_backend::Memory_backend(QObject * parent) noexcept : Ledger_backend(parent), random_(QRandomGenerator::securelySeeded()) {
+}
+
+void Memory_backend::set_latency(const int latency_ms, const int jitter_ms) noexcept {
+	latency_ms_ = std::max(0, latency_ms);
+	jitter_ms_ = std::max(0, jitter_ms);
+}
+
+template<typename T>
+void Memory_backend::respond(T && func) noexcept {
+	const auto delay = latency_ms_ + (jitter_ms_ > 0 ? random_.bounded(jitter_ms_ + 1) : 0);
+	QTimer::singleShot(delay, Qt::PreciseTimer, this, std::forward<T>(func));
+}
+
+void Memory_backend::Totals::add(const Record & record, const int sign) noexcept {
+	bale_sold += sign * record.bale_sold;
+	weight_sold += sign * record.weight_sold;
+	amount += sign * record.amount;
+	received_amount += sign * record.received_amount;
+}
+
+QVariantMap Memory_backend::Totals::to_variant_map() const noexcept {
+	return {
+		{"totalBaleSold", static_cast<int>(bale_sold)},
+		{"totalWeightSold", static_cast<int>(weight_sold)},
+		{"totalAmount", static_cast<int>(amount)},
+		{"totalReceivedAmount", static_cast<int>(received_amount)}
+	};
+}
+
+void Memory_backend::get_bale() noexcept {
+
+	respond([this]() {
+		emit getBaleResponse({
+			{"error", false},
+			{"baleAmount", static_cast<int>(bale_amount_)},
+			{"baleWeight", static_cast<int>(bale_weight_)}
+		});
+	});
+}
+
+void Memory_backend::set_bale(const int bale_amount, const int bale_weight) noexcept {
+
+	respond([this, bale_amount, bale_weight]() {
+		bale_amount_ = bale_amount;
+		bale_weight_ = bale_weight;
+
+		emit setBaleResponse({{"error", false}, {"baleAmount", bale_amount}, {"baleWeight", bale_weight}});
+	});
+}
+
+void Memory_backend::add_record(const QVariantMap & data) noexcept {
+	const auto doc_id = "memory" + QString::number(next_doc_id_++);
+
+	respond([this, data, doc_id]() {
+		auto record = Record::from_variant_map(data);
+		record.doc_id = doc_id;
+
+		auto & day = days_[normalize_date(record.date)];
+		day.totals.add(record, 1);
+		day.records[doc_id] = record;
+
+		auto & user = users_[normalize_name(record.name)];
+		user.name = record.name;
+		user.phone = data["phone"].toString();
+		user.totals.add(record, 1);
+		user.debt += record.amount - record.received_amount;
+		user.doc_ids.insert(doc_id);
+
+		bale_amount_ -= record.bale_sold;
+		bale_weight_ -= record.weight_sold;
+
+		auto response = data;
+		response["error"] = false;
+		response["docID"] = doc_id;
+
+		emit addRecordResponse(response);
+	});
+}
+
+void Memory_backend::delete_record(const QVariantMap & data) noexcept {
+
+	respond([this, data]() {
+		const auto doc_id = data["docID"].toString();
+		const auto day = days_.find(normalize_date(data["date"].toString()));
+
+		QVariantMap response;
+		response["docID"] = doc_id;
+
+		if(day == days_.end() || !day->second.records.count(doc_id)) {
+			response["error"] = true;
+			emit deleteRecordResponse(response);
+			return;
+		}
+
+		const auto record = day->second.records[doc_id];
+		day->second.records.erase(doc_id);
+		day->second.totals.add(record, -1);
+
+		// an emptied day disappears like it does once its last record is deleted in firestore
+		if(day->second.records.empty()) {
+			days_.erase(day);
+		}
+
+		const auto user = users_.find(normalize_name(record.name));
+
+		if(user != users_.end()) {
+			user->second.totals.add(record, -1);
+			user->second.debt -= record.amount - record.received_amount;
+			user->second.doc_ids.remove(doc_id);
+
+			if(user->second.doc_ids.isEmpty()) {
+				users_.erase(user);
+			}
+		}
+
+		bale_amount_ += record.bale_sold;
+		bale_weight_ += record.weight_sold;
+
+		response["error"] = false;
+		response["totalAmountDelta"] = -record.amount;
+		response["totalReceivedAmountDelta"] = -record.received_amount;
+		response["totalBaleSoldDelta"] = -record.bale_sold;
+		response["totalWeightSoldDelta"] = -record.weight_sold;
+		response["baleAmountDelta"] = record.bale_sold;
+		response["baleWeightDelta"] = record.weight_sold;
+
+		emit deleteRecordResponse(response);
+	});
+}
+
+void Memory_backend::get_daily_records(const QString & date) noexcept {
+
+	respond([this, day_id = normalize_date(date)]() {
+		const auto day = days_.find(day_id);
+
+		if(day == days_.end()) {
+			emit getDailyRecordsResponseMetadata({{"empty", true}});
+			return;
+		}
+
+		auto metadata = day->second.totals.to_variant_map();
+		metadata["empty"] = false;
+		emit getDailyRecordsResponseMetadata(metadata);
+
+		QList<Record> records;
+		records.reserve(static_cast<qsizetype>(day->second.records.size()));
+
+		for(const auto & [doc_id, record] : day->second.records) {
+			records.append(record);
+		}
+
+		daily_records_.set_records(records);
+		emit getDailyRecordsResponse({{"error", false}, {"empty", records.isEmpty()}});
+	});
+}
+
+void Memory_backend::get_user_records(const QString & name) noexcept {
+
+	respond([this, key = normalize_name(name)]() {
+		const auto user = users_.find(key);
+
+		if(user == users_.end()) {
+			emit getUserRecordsResponseMetadata({{"empty", true}});
+			return;
+		}
+
+		auto metadata = user->second.totals.to_variant_map();
+		metadata["name"] = user->second.name;
+		metadata["phone"] = user->second.phone;
+		metadata["debt"] = static_cast<int>(user->second.debt);
+		emit getUserRecordsResponseMetadata(metadata);
+
+		QList<Record> records;
+
+		for(const auto & [day_id, day] : days_) {
+
+			for(const auto & [doc_id, record] : day.records) {
+
+				if(user->second.doc_ids.contains(doc_id)) {
+					records.append(record);
+				}
+			}
+		}
+
+		// newest day first, the whole history in one page
+		std::reverse(records.begin(), records.end());
+
+		user_records_.set_records(records);
+		emit getUserRecordsResponse({{"error", false}, {"empty", records.isEmpty()}, {"hasMore", false}});
+	});
+}
+
+void Memory_backend::get_users(const QString & prefix, const int limit) noexcept {
+
+	respond([this, normalized_prefix = normalize_name(prefix), limit]() {
+		QVariantList users_list;
+
+		for(auto it = users_.lower_bound(normalized_prefix); it != users_.end() && users_list.size() < limit; ++it) {
+
+			if(!it->first.startsWith(normalized_prefix)) {
+				break;
+			}
+
+			users_list.append(QVariantMap{{"name", it->second.name}, {"phone", it->second.phone}});
+		}
+
+		emit getUsersResponse({{"error", false}, {"empty", users_list.isEmpty()}, {"users", users_list}});
+	});
+}
+
+void Memory_backend::get_monthly_totals(const int month, const int year) noexcept {
+
+	respond([this, month, year]() {
+		const auto month_id = (QString::number(year) + QString::number(month).rightJustified(2, '0')).toStdString();
+
+		Totals totals;
+
+		for(auto it = days_.lower_bound(month_id); it != days_.end() && it->first.compare(0, month_id.size(), month_id) == 0; ++it) {
+			totals.bale_sold += it->second.totals.bale_sold;
+			totals.weight_sold += it->second.totals.weight_sold;
+			totals.amount += it->second.totals.amount;
+			totals.received_amount += it->second.totals.received_amount;
+		}
+
+		auto response = totals.to_variant_map();
+		response["error"] = false;
+		response["month"] = month;
+		response["year"] = year;
+
+		emit getMonthlyTotalsResponse(response);
+	});
+}
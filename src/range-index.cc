@@ -0,0 +1,160 @@
+#include "range-index.h"
+
+#include <QDate>
+
+#include <algorithm>
+
+Range_index::Totals & Range_index::Totals::operator+=(const Totals & other) noexcept {
+	bale_sold += other.bale_sold;
+	weight_sold += other.weight_sold;
+	amount += other.amount;
+	received_amount += other.received_amount;
+	return *this;
+}
+
+Range_index::Totals & Range_index::Totals::operator-=(const Totals & other) noexcept {
+	bale_sold -= other.bale_sold;
+	weight_sold -= other.weight_sold;
+	amount -= other.amount;
+	received_amount -= other.received_amount;
+	return *this;
+}
+
+int64_t Range_index::ordinal(const std::string & day) noexcept {
+
+	if(day.size() != 8 || !std::all_of(day.begin(), day.end(), [](const char c) { return c >= '0' && c <= '9'; })) {
+		return -1;
+	}
+
+	const int64_t year = std::stoi(day.substr(0, 4));
+	const int64_t month = std::stoi(day.substr(4, 2));
+	const int64_t date = std::stoi(day.substr(6, 2));
+
+	if(!QDate::isValid(static_cast<int>(year), static_cast<int>(month), static_cast<int>(date))) {
+		return -1;
+	}
+
+	// days since 0000-03-01 in the proleptic gregorian calendar, march first so leap days fall at the end of a year
+	const auto shifted_year = month <= 2 ? year - 1 : year;
+	const auto day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + date - 1;
+
+	return shifted_year * 365 + shifted_year / 4 - shifted_year / 100 + shifted_year / 400 + day_of_year;
+}
+
+void Range_index::rebuild(const int64_t first, const int64_t size) noexcept {
+	std::vector<Totals> values(static_cast<size_t>(size));
+
+	for(size_t slot = 0; slot < values_.size(); ++slot) {
+		values[static_cast<size_t>(first_ - first) + slot] = values_[slot];
+	}
+
+	first_ = first;
+	values_ = std::move(values);
+
+	// linear construction: every node hands its sum to its parent once
+	tree_ = values_;
+
+	for(size_t i = 1; i <= tree_.size(); ++i) {
+		const auto parent = i + (i & (~i + 1));
+
+		if(parent <= tree_.size()) {
+			tree_[parent - 1] += tree_[i - 1];
+		}
+	}
+}
+
+void Range_index::reset(const std::map<std::string, Totals> & days) noexcept {
+	first_ = 0;
+	values_.clear();
+	tree_.clear();
+
+	int64_t first = -1;
+	int64_t last = -1;
+
+	for(const auto & [day, totals] : days) {
+		const auto at = ordinal(day);
+
+		if(at < 0) {
+			continue;
+		}
+
+		first = first < 0 ? at : std::min(first, at);
+		last = std::max(last, at);
+	}
+
+	loaded_ = true;
+
+	if(first < 0) {
+		return;
+	}
+
+	// room for a year of new days before the next rebuild
+	first_ = first;
+	values_.assign(static_cast<size_t>(last - first + 1 + 366), {});
+
+	for(const auto & [day, totals] : days) {
+		const auto at = ordinal(day);
+
+		if(at >= 0) {
+			values_[static_cast<size_t>(at - first_)] += totals;
+		}
+	}
+
+	rebuild(first_, static_cast<int64_t>(values_.size()));
+}
+
+void Range_index::add(const std::string & day, const Totals & delta) noexcept {
+	const auto at = ordinal(day);
+
+	if(at < 0) {
+		return;
+	}
+
+	if(values_.empty()) {
+		first_ = at;
+		values_.assign(366, {});
+		rebuild(at, 366);
+	} else if(at < first_ || at >= first_ + static_cast<int64_t>(values_.size())) {
+		const auto first = std::min(first_, at);
+		const auto last = std::max(first_ + static_cast<int64_t>(values_.size()) - 1, at);
+
+		// doubling keeps the rebuilds amortized when days keep arriving past the end
+		rebuild(first, std::max(last - first + 1, static_cast<int64_t>(values_.size()) * 2));
+	}
+
+	values_[static_cast<size_t>(at - first_)] += delta;
+
+	for(auto i = static_cast<size_t>(at - first_) + 1; i <= tree_.size(); i += i & (~i + 1)) {
+		tree_[i - 1] += delta;
+	}
+}
+
+Range_index::Totals Range_index::prefix(const int64_t ordinal) const noexcept {
+	Totals totals;
+
+	if(ordinal < first_ || tree_.empty()) {
+		return totals;
+	}
+
+	auto i = static_cast<size_t>(std::min(ordinal - first_ + 1, static_cast<int64_t>(tree_.size())));
+
+	for(; i > 0; i -= i & (~i + 1)) {
+		totals += tree_[i - 1];
+	}
+
+	return totals;
+}
+
+Range_index::Totals Range_index::sum(const std::string & from, const std::string & to) const noexcept {
+	const auto first = ordinal(from);
+	const auto last = ordinal(to);
+
+	if(first < 0 || last < first) {
+		return {};
+	}
+
+	auto totals = prefix(last);
+	totals -= prefix(first - 1);
+
+	return totals;
+}
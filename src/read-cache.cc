@@ -0,0 +1,96 @@
+#include "read-cache.h"
+
+#include <QMetaObject>
+
+#include <algorithm>
+
+Read_cache::Read_cache(QObject * owner, const int ttl_ms) noexcept : owner_(owner), ttl_ms_(std::max(0, ttl_ms)) {
+}
+
+void Read_cache::set_ttl(const int ttl_ms) noexcept {
+	ttl_ms_ = std::max(0, ttl_ms);
+	clear();
+}
+
+bool Read_cache::join(const QString & key) noexcept {
+	auto & entry = entries_[key];
+
+	if(entry.in_flight) {
+		++entry.waiters;
+		return false;
+	}
+
+	if(entry.cached && !entry.expires.hasExpired()) {
+		QMetaObject::invokeMethod(owner_, entry.cached, Qt::QueuedConnection);
+		return false;
+	}
+
+	entry.cached = nullptr;
+	entry.in_flight = true;
+	entry.stale = false;
+	entry.waiters = 1;
+
+	return true;
+}
+
+void Read_cache::finish(const QString & key, const Apply & apply, const bool cacheable, const bool caller_answered) noexcept {
+	const auto it = entries_.find(key);
+
+	// the read was not started through join, there is no one else to answer
+	if(it == entries_.end() || !it->in_flight) {
+
+		if(!caller_answered) {
+			apply();
+		}
+
+		return;
+	}
+
+	const auto waiters = it->waiters - (caller_answered ? 1 : 0);
+	const auto keep = cacheable && !it->stale && ttl_ms_ > 0;
+
+	it->in_flight = false;
+	it->waiters = 0;
+
+	if(keep) {
+		it->cached = apply;
+		it->expires = QDeadlineTimer(ttl_ms_);
+	} else {
+		entries_.erase(it);
+	}
+
+	// apply may start new reads, so nothing touches the entry after this
+	if(waiters > 0) {
+		apply();
+	}
+}
+
+void Read_cache::invalidate(const QString & key) noexcept {
+	const auto it = entries_.find(key);
+
+	if(it == entries_.end()) {
+		return;
+	}
+
+	if(it->in_flight) {
+		it->stale = true;
+		it->cached = nullptr;
+		return;
+	}
+
+	entries_.erase(it);
+}
+
+void Read_cache::clear() noexcept {
+
+	for(auto it = entries_.begin(); it != entries_.end();) {
+
+		if(it->in_flight) {
+			it->stale = true;
+			it->cached = nullptr;
+			++it;
+		} else {
+			it = entries_.erase(it);
+		}
+	}
+}
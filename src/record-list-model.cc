@@ -0,0 +1,149 @@
+#include "record-list-model.h"
+
+Record_list_model::Record_list_model(QObject * parent) noexcept : QAbstractListModel(parent) {
+}
+
+int Record_list_model::rowCount(const QModelIndex & parent) const {
+
+	if(parent.isValid()) {
+		return 0;
+	}
+
+	return count();
+}
+
+QVariant Record_list_model::data(const QModelIndex & index, const int role) const {
+
+	if(!index.isValid() || index.row() >= records_.size()) {
+		return {};
+	}
+
+	const auto & record = records_[index.row()];
+
+	switch(role) {
+		case DocIdRole: return record.doc_id;
+		case DateRole: return record.date;
+		case NameRole: return record.name;
+		case BaleSoldRole: return record.bale_sold;
+		case WeightSoldRole: return record.weight_sold;
+		case RateRole: return record.rate;
+		case AmountRole: return record.amount;
+		case ReceivedAmountRole: return record.received_amount;
+		default: return {};
+	}
+}
+
+QHash<int, QByteArray> Record_list_model::roleNames() const {
+	return {
+		{DocIdRole, "docID"},
+		{DateRole, "date"},
+		{NameRole, "name"},
+		{BaleSoldRole, "baleSold"},
+		{WeightSoldRole, "weightSold"},
+		{RateRole, "rate"},
+		{AmountRole, "amount"},
+		{ReceivedAmountRole, "receivedAmount"}
+	};
+}
+
+void Record_list_model::set_records(const QList<Record> & records) noexcept {
+	clear();
+
+	if(records.isEmpty()) {
+		return;
+	}
+
+	beginInsertRows({}, 0, static_cast<int>(records.size()) - 1);
+
+	records_ = records;
+	rows_.reserve(records_.size());
+
+	for(int row = 0; row < records_.size(); ++row) {
+		rows_.insert(records_[row].doc_id, row);
+	}
+
+	endInsertRows();
+	emit countChanged();
+}
+
+void Record_list_model::append_records(const QList<Record> & records) noexcept {
+
+	if(records.isEmpty()) {
+		return;
+	}
+
+	const int first = static_cast<int>(records_.size());
+
+	beginInsertRows({}, first, first + static_cast<int>(records.size()) - 1);
+
+	records_.append(records);
+
+	for(int row = first; row < records_.size(); ++row) {
+		rows_.insert(records_[row].doc_id, row);
+	}
+
+	endInsertRows();
+	emit countChanged();
+}
+
+void Record_list_model::clear() noexcept {
+
+	if(records_.isEmpty()) {
+		return;
+	}
+
+	beginRemoveRows({}, 0, static_cast<int>(records_.size()) - 1);
+	records_.clear();
+	rows_.clear();
+	endRemoveRows();
+
+	emit countChanged();
+}
+
+void Record_list_model::add_record(const QVariantMap & data) noexcept {
+	add_record(Record::from_variant_map(data));
+}
+
+void Record_list_model::add_record(const Record & record) noexcept {
+
+	if(const auto it = rows_.constFind(record.doc_id); it != rows_.cend()) {
+		const int row = it.value();
+		records_[row] = record;
+
+		emit dataChanged(index(row), index(row));
+		return;
+	}
+
+	const int row = static_cast<int>(records_.size());
+
+	beginInsertRows({}, row, row);
+	records_.append(record);
+	rows_.insert(record.doc_id, row);
+	endInsertRows();
+
+	emit countChanged();
+}
+
+bool Record_list_model::remove_record(const QString & doc_id) noexcept {
+	const auto it = rows_.find(doc_id);
+
+	if(it == rows_.end()) {
+		return false;
+	}
+
+	const int row = it.value();
+
+	beginRemoveRows({}, row, row);
+	records_.removeAt(row);
+	rows_.erase(it);
+
+	// the rows after it move up one, so the list keeps its order
+	for(int later = row; later < records_.size(); ++later) {
+		rows_[records_[later].doc_id] = later;
+	}
+
+	endRemoveRows();
+
+	emit countChanged();
+	return true;
+}
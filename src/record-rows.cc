@@ -0,0 +1,200 @@
+#include "record-rows.h"
+
+#include <QByteArrayList>
+#include <QDate>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "normalize.h"
+
+static const QStringList CSV_COLUMNS = {"docID", "date", "name", "phone", "baleSold", "weightSold", "rate", "amount", "receivedAmount"};
+
+static QByteArray csv_field(const QString & value) {
+	auto field = value.toUtf8();
+
+	if(field.contains(',') || field.contains('"') || field.contains('\n')) {
+		field.replace("\"", "\"\"");
+		field = '"' + field + '"';
+	}
+
+	return field;
+}
+
+Record_rows::Format Record_rows::format_of(const QString & path) noexcept {
+	return path.endsWith(".csv", Qt::CaseInsensitive) ? Format::Csv : Format::Ndjson;
+}
+
+QByteArray Record_rows::header(const Format format) noexcept {
+
+	if(format == Format::Ndjson) {
+		return {};
+	}
+
+	return CSV_COLUMNS.join(',').toUtf8() + '\n';
+}
+
+QByteArray Record_rows::encode(const Record & record, const Format format) noexcept {
+
+	if(format == Format::Ndjson) {
+		return QJsonDocument(QJsonObject::fromVariantMap(record.to_variant_map())).toJson(QJsonDocument::Compact) + '\n';
+	}
+
+	const QByteArrayList fields = {
+		csv_field(record.doc_id),
+		csv_field(record.date),
+		csv_field(record.name),
+		// the phone lives on the customer, not the record
+		QByteArray(),
+		QByteArray::number(record.bale_sold),
+		QByteArray::number(record.weight_sold),
+		QByteArray::number(record.rate, 'g', 7),
+		QByteArray::number(record.amount),
+		QByteArray::number(record.received_amount)
+	};
+
+	return fields.join(',') + '\n';
+}
+
+Record_rows::Record_rows(QIODevice * device, const Format format) noexcept : device_(device), format_(format) {
+}
+
+QStringList Record_rows::split_csv(const QByteArray & line) noexcept {
+	QStringList fields;
+	QByteArray field;
+	bool quoted = false;
+
+	for(qsizetype i = 0; i < line.size(); ++i) {
+		const auto c = line[i];
+
+		if(quoted) {
+
+			if(c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+				field += '"';
+				++i;
+			} else if(c == '"') {
+				quoted = false;
+			} else {
+				field += c;
+			}
+
+		} else if(c == '"') {
+			quoted = true;
+		} else if(c == ',') {
+			fields.append(QString::fromUtf8(field).trimmed());
+			field.clear();
+		} else {
+			field += c;
+		}
+	}
+
+	fields.append(QString::fromUtf8(field).trimmed());
+
+	return fields;
+}
+
+QString Record_rows::validate(const Row & row) noexcept {
+	const auto & record = row.record;
+
+	if(!valid_date(record.date)) {
+		return "date is not DD-MM-YYYY";
+	}
+
+	if(normalize_name(record.name).isEmpty()) {
+		return "name is empty";
+	}
+
+	if(record.bale_sold < 0 || record.weight_sold < 0 || record.rate < 0 || record.amount < 0 || record.received_amount < 0) {
+		return "negative quantity";
+	}
+
+	if(record.weight_sold == 0 && record.amount == 0 && record.received_amount == 0) {
+		return "empty sale";
+	}
+
+	return {};
+}
+
+bool Record_rows::next(Row & row, QString & error) noexcept {
+	QByteArray line;
+
+	do {
+
+		if(device_->atEnd()) {
+			return false;
+		}
+
+		line = device_->readLine().trimmed();
+		++line_;
+
+		if(format_ == Format::Csv && columns_.isEmpty() && !line.isEmpty()) {
+			const auto names = split_csv(line);
+
+			for(int i = 0; i < names.size(); ++i) {
+				columns_[names[i]] = i;
+			}
+
+			line.clear();
+		}
+
+	} while(line.isEmpty());
+
+	QVariantMap data;
+
+	if(format_ == Format::Ndjson) {
+		const auto object = QJsonDocument::fromJson(line).object();
+
+		if(object.isEmpty()) {
+			error = "not a json object";
+			return true;
+		}
+
+		data = object.toVariantMap();
+	} else {
+		const auto fields = split_csv(line);
+
+		for(auto it = columns_.cbegin(); it != columns_.cend(); ++it) {
+
+			if(it.value() < fields.size()) {
+				data[it.key()] = fields[it.value()];
+			}
+		}
+	}
+
+	for(const auto & required : {"date", "name", "baleSold", "weightSold", "rate", "amount", "receivedAmount"}) {
+
+		if(!data.contains(required)) {
+			error = QString("missing ") + required;
+			return true;
+		}
+	}
+
+	// toInt() and toFloat() read anything that is not a number as 0
+	for(const auto & field : {"baleSold", "weightSold", "amount", "receivedAmount"}) {
+		bool ok = false;
+		data[field].toInt(&ok);
+
+		if(!ok) {
+			error = QString(field) + " is not a whole number";
+			return true;
+		}
+	}
+
+	bool rate_ok = false;
+	data["rate"].toFloat(&rate_ok);
+
+	if(!rate_ok) {
+		error = "rate is not a number";
+		return true;
+	}
+
+	row.record = Record::from_variant_map(data);
+	row.phone = data["phone"].toString();
+	error = validate(row);
+
+	// stored as the app writes dates, so the same day never shows up under two spellings
+	if(error.isEmpty()) {
+		row.record.date = QDate::fromString(row.record.date, "d-M-yyyy").toString("dd-MM-yyyy");
+	}
+
+	return true;
+}
@@ -0,0 +1,489 @@
+#include "rpc-server.h"
+#include "firebase.h"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+#include <algorithm>
+#include <vector>
+
+static QVariantList model_rows(const Record_list_model & model) noexcept {
+	QVariantList rows;
+	rows.reserve(model.count());
+
+	for(const auto & record : model.records()) {
+		rows.append(record.to_variant_map());
+	}
+
+	return rows;
+}
+
+static bool is_map(const QVariant & value) noexcept {
+	return value.typeId() == QMetaType::QVariantMap;
+}
+
+// the named params that are not DD-MM-YYYY dates, as an error message
+static QString check_dates(const QVariantList & args, const QStringList & names) noexcept {
+
+	for(qsizetype i = 0; i < args.size() && i < names.size(); ++i) {
+
+		if(args[i].typeId() != QMetaType::QString || !valid_date(args[i].toString())) {
+			return names[i] + " must be a date as DD-MM-YYYY";
+		}
+	}
+
+	return {};
+}
+
+Rpc_server::Rpc_server(Firebase * firebase, QObject * parent) noexcept : QObject(parent), firebase_(firebase) {
+	// only this user may connect, the socket hands out every customer's ledger
+	server_.setSocketOptions(QLocalServer::UserAccessOption);
+
+	connect(&server_, &QLocalServer::newConnection, this, &Rpc_server::on_connection);
+
+	add_method("get_bale", {{}, "getBaleResponse", &Firebase::getBaleResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList &) {
+			firebase.get_bale();
+		}, nullptr});
+
+	add_method("set_bale", {{"baleAmount", "baleWeight"}, "setBaleResponse", &Firebase::setBaleResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.set_bale(args[0].toInt(), args[1].toInt());
+		}, nullptr});
+
+	// writes come back tagged, so any number can be in flight
+	add_method("add_record", {{"data"}, "addRecordResponse", &Firebase::addRecordResponse, {}, nullptr, {TAG_FIELD},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.add_record(args[0].toMap());
+		}, nullptr,
+		[](const QVariantList & args) {
+			return is_map(args[0]) ? Record::invalid_fields(args[0].toMap()) : QString("data must be an object");
+		}});
+
+	add_method("delete_record", {{"data"}, "deleteRecordResponse", &Firebase::deleteRecordResponse, {}, nullptr, {"docID"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.delete_record(args[0].toMap());
+		}, nullptr,
+		[](const QVariantList & args) {
+
+			if(!is_map(args[0]) || args[0].toMap()["docID"].toString().isEmpty()) {
+				return QString("data must be an object with a docID");
+			}
+
+			return check_dates({args[0].toMap()["date"]}, {"data.date"});
+		}});
+
+	// the records land in the backend's models, which hold one day and one customer at a time
+	add_method("get_daily_records", {{"date"}, "getDailyRecordsResponseMetadata", &Firebase::getDailyRecordsResponseMetadata,
+		"getDailyRecordsResponse", &Firebase::getDailyRecordsResponse, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_daily_records(args[0].toString());
+		},
+		[](Firebase & firebase, QVariantMap result) {
+			result["records"] = model_rows(*firebase.daily_records());
+			return result;
+		},
+		[](const QVariantList & args) {
+			return check_dates(args, {"date"});
+		}});
+
+	add_method("get_user_records", {{"name"}, "getUserRecordsResponseMetadata", &Firebase::getUserRecordsResponseMetadata,
+		"getUserRecordsResponse", &Firebase::getUserRecordsResponse, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_user_records(args[0].toString());
+		},
+		[](Firebase & firebase, QVariantMap result) {
+			result["records"] = model_rows(*firebase.user_records());
+			return result;
+		}});
+
+	add_method("get_users", {{"prefix", "limit"}, "getUsersResponse", &Firebase::getUsersResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_users(args[0].toString(), args[1].toInt());
+		}, nullptr});
+
+	add_method("get_monthly_totals", {{"month", "year"}, "getMonthlyTotalsResponse", &Firebase::getMonthlyTotalsResponse, {}, nullptr, {"month", "year"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_monthly_totals(args[0].toInt(), args[1].toInt());
+		}, nullptr});
+
+	add_method("get_yearly_totals", {{"year"}, "getYearlyTotalsResponse", &Firebase::getYearlyTotalsResponse, {}, nullptr, {"year"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_yearly_totals(args[0].toInt());
+		}, nullptr});
+
+	add_method("get_range_totals", {{"from", "to"}, "getRangeTotalsResponse", &Firebase::getRangeTotalsResponse, {}, nullptr, {"from", "to"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_range_totals(args[0].toString(), args[1].toString());
+		}, nullptr,
+		[](const QVariantList & args) {
+			return check_dates(args, {"from", "to"});
+		}});
+
+	add_method("get_consolidated_daily_totals", {{"date"}, "getConsolidatedTotalsResponse", &Firebase::getConsolidatedTotalsResponse, {}, nullptr, {"date"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_consolidated_daily_totals(args[0].toString());
+		}, nullptr,
+		[](const QVariantList & args) {
+			return check_dates(args, {"date"});
+		}});
+
+	add_method("get_consolidated_monthly_totals", {{"month", "year"}, "getConsolidatedTotalsResponse", &Firebase::getConsolidatedTotalsResponse, {}, nullptr,
+		{"month", "year"},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_consolidated_monthly_totals(args[0].toInt(), args[1].toInt());
+		}, nullptr});
+
+	add_method("get_top_debtors", {{"n"}, "getTopDebtorsResponse", &Firebase::getTopDebtorsResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_top_debtors(args[0].toInt());
+		}, nullptr});
+
+	add_method("get_debt_aging", {{}, "getDebtAgingResponse", &Firebase::getDebtAgingResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList &) {
+			firebase.get_debt_aging();
+		}, nullptr});
+
+	add_method("load_analytics", {{"from", "to"}, "loadAnalyticsResponse", &Firebase::loadAnalyticsResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.load_analytics(args[0].toString(), args[1].toString());
+		}, nullptr,
+		[](const QVariantList & args) {
+			return check_dates(args, {"from", "to"});
+		}});
+
+	add_method("get_analytics", {{"query"}, "getAnalyticsResponse", &Firebase::getAnalyticsResponse, {}, nullptr, {},
+		[](Firebase & firebase, const QVariantList & args) {
+			firebase.get_analytics(args[0].toMap());
+		}, nullptr});
+}
+
+void Rpc_server::add_method(const QString & name, Method method) noexcept {
+
+	if(!connected_.contains(method.response)) {
+		connected_.insert(method.response);
+
+		connect(firebase_, method.signal, this, [this, signal = method.response](const QVariantMap & response) {
+			on_response(signal, response);
+		});
+	}
+
+	if(method.then_signal && !connected_.contains(method.then)) {
+		connected_.insert(method.then);
+		firsts_[method.then] = method.response;
+
+		connect(firebase_, method.then_signal, this, [this, signal = method.then](const QVariantMap & response) {
+			on_then(signal, response);
+		});
+	}
+
+	// made up front, so no later insert moves a queue someone holds
+	in_flight_[method.response];
+	queued_[method.response];
+
+	methods_[name] = std::move(method);
+}
+
+bool Rpc_server::listen(const QString & name) noexcept {
+
+	if(server_.listen(name)) {
+		return true;
+	}
+
+	// a socket file left behind by a server that crashed, nothing answers on it
+	if(server_.serverError() == QAbstractSocket::AddressInUseError) {
+		QLocalSocket probe;
+		probe.connectToServer(name);
+
+		if(!probe.waitForConnected(1000)) {
+			QLocalServer::removeServer(name);
+			return server_.listen(name);
+		}
+	}
+
+	return false;
+}
+
+void Rpc_server::on_connection() noexcept {
+
+	while(auto * socket = server_.nextPendingConnection()) {
+		connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+			on_readable(socket);
+		});
+
+		connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+	}
+}
+
+void Rpc_server::on_readable(QLocalSocket * socket) noexcept {
+
+	// every complete line is a request, so a script can pipeline as many as it likes
+	while(socket->canReadLine()) {
+		const auto line = socket->readLine().trimmed();
+
+		if(!line.isEmpty()) {
+			on_request(socket, line);
+		}
+	}
+
+	if(socket->bytesAvailable() > MAX_LINE_BYTES) {
+		qWarning() << "Dropping an rpc client whose request has no end.";
+		socket->abort();
+	}
+}
+
+void Rpc_server::on_request(QLocalSocket * socket, const QByteArray & line) noexcept {
+	QJsonParseError parse_error;
+	const auto document = QJsonDocument::fromJson(line, &parse_error);
+
+	if(parse_error.error != QJsonParseError::NoError) {
+		return reply_error(socket, QJsonValue::Null, PARSE_ERROR, parse_error.errorString());
+	}
+
+	const auto request = document.object();
+	// a request without an id is a notification and gets no answer
+	const auto id = request.value("id");
+
+	if(!document.isObject() || request.value("jsonrpc") != "2.0" || !request.value("method").isString()) {
+		return reply_error(socket, id.isUndefined() ? QJsonValue::Null : id, INVALID_REQUEST, "expected a json-rpc 2.0 request object");
+	}
+
+	const auto it = methods_.find(request.value("method").toString());
+
+	if(it == methods_.end()) {
+		return reply_error(socket, id, METHOD_NOT_FOUND, "no method " + request.value("method").toString());
+	}
+
+	const auto & method = it->second;
+	const auto params = request.value("params");
+
+	Pending pending;
+	pending.socket = socket;
+	pending.id = id;
+	pending.method = &method;
+
+	// params by position or by name
+	if(params.isArray() && params.toArray().size() == method.params.size()) {
+		pending.args = params.toArray().toVariantList();
+	} else if(params.isObject() && std::all_of(method.params.begin(), method.params.end(), [&](const QString & name) { return params.toObject().contains(name); })) {
+
+		for(const auto & name : method.params) {
+			pending.args.append(params.toObject().value(name).toVariant());
+		}
+
+	} else if(!params.isUndefined() || !method.params.isEmpty()) {
+		return reply_error(socket, id, INVALID_PARAMS, "expected " + method.params.join(", "));
+	}
+
+	if(method.check) {
+
+		if(const auto problem = method.check(pending.args); !problem.isEmpty()) {
+			return reply_error(socket, id, INVALID_PARAMS, problem);
+		}
+	}
+
+	if(method.keys.contains(TAG_FIELD)) {
+		auto data = pending.args[0].toMap();
+		data[TAG_FIELD] = ++next_tag_;
+		pending.args[0] = data;
+	}
+
+	for(const auto & key : method.keys) {
+		const auto index = method.params.indexOf(key);
+
+		if(index >= 0) {
+			pending.expected[key] = pending.args[index];
+			continue;
+		}
+
+		for(const auto & arg : pending.args) {
+
+			if(arg.toMap().contains(key)) {
+				pending.expected[key] = arg.toMap().value(key);
+				break;
+			}
+		}
+	}
+
+	// keyed calls go out at once, unkeyed ones wait their turn behind the call ahead of them
+	if(method.keys.isEmpty()) {
+		queued_[method.response].push_back(std::move(pending));
+		return advance(method.response);
+	}
+
+	const auto call = method.call;
+	const auto args = pending.args;
+
+	// queued before the call, which may answer before it returns
+	in_flight_[method.response].push_back(std::move(pending));
+	call(*firebase_, args);
+}
+
+void Rpc_server::advance(const QByteArray & signal) noexcept {
+
+	// a call that answers before it returns lands back here, the loop below carries on after it
+	if(advancing_.contains(signal)) {
+		return;
+	}
+
+	advancing_.insert(signal);
+
+	auto & queue = queued_[signal];
+
+	while(!queue.empty() && in_flight_[signal].empty()) {
+		auto pending = std::move(queue.front());
+		queue.pop_front();
+
+		// nobody is left to read the answer
+		if(!pending.socket) {
+			continue;
+		}
+
+		const auto call = pending.method->call;
+		const auto args = pending.args;
+
+		in_flight_[signal].push_back(std::move(pending));
+		call(*firebase_, args);
+	}
+
+	advancing_.remove(signal);
+}
+
+void Rpc_server::on_response(const QByteArray & signal, const QVariantMap & response) noexcept {
+	auto & calls = in_flight_[signal];
+
+	const auto matches = [&response](const Pending & pending) {
+
+		if(pending.metadata) {
+			return false;
+		}
+
+		for(auto it = pending.expected.begin(); it != pending.expected.end(); ++it) {
+
+			// compared as text, json numbers arrive as doubles and responses carry ints
+			if(response.value(it.key()).toString() != it.value().toString()) {
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	auto it = std::find_if(calls.begin(), calls.end(), matches);
+
+	// identical calls share the backend's read, one signal answers all of them
+	if(it != calls.end() && !it->expected.isEmpty() && it->method->then.isEmpty()) {
+		const auto * method = it->method;
+		std::vector<Pending> answered;
+
+		for(auto call = it; call != calls.end();) {
+
+			if(call->method == method && matches(*call)) {
+				answered.push_back(std::move(*call));
+				call = calls.erase(call);
+			} else {
+				++call;
+			}
+		}
+
+		for(const auto & pending : answered) {
+			answer(pending, response);
+		}
+
+		return advance(signal);
+	}
+
+	// error responses may not echo the keys, they go to the oldest call waiting on the signal
+	if(it == calls.end()) {
+		it = std::find_if(calls.begin(), calls.end(), [&response](const Pending & pending) {
+			return !pending.metadata && std::none_of(pending.method->keys.begin(), pending.method->keys.end(), [&response](const QString & key) {
+				return response.contains(key);
+			});
+		});
+	}
+
+	// answers to the ui or to nobody, e.g. a search the customer index finished on its own
+	if(it == calls.end()) {
+		return;
+	}
+
+	if(!it->method->then.isEmpty() && !response["error"].toBool() && !response["empty"].toBool()) {
+		it->metadata = response;
+		return;
+	}
+
+	const auto pending = std::move(*it);
+	calls.erase(it);
+
+	answer(pending, response);
+	advance(signal);
+}
+
+void Rpc_server::on_then(const QByteArray & signal, const QVariantMap & response) noexcept {
+	const auto first = firsts_.value(signal);
+	auto & calls = in_flight_[first];
+
+	const auto it = std::find_if(calls.begin(), calls.end(), [](const Pending & pending) { return pending.metadata.has_value(); });
+
+	if(it == calls.end()) {
+		return;
+	}
+
+	const auto pending = std::move(*it);
+	calls.erase(it);
+
+	// the metadata's fields with the rest's on top
+	auto result = *pending.metadata;
+
+	for(auto field = response.begin(); field != response.end(); ++field) {
+		result[field.key()] = field.value();
+	}
+
+	answer(pending, result);
+	advance(first);
+}
+
+void Rpc_server::answer(const Pending & pending, QVariantMap result) noexcept {
+
+	if(!pending.socket || pending.id.isUndefined()) {
+		return;
+	}
+
+	if(pending.method->finish) {
+		result = pending.method->finish(*firebase_, result);
+	}
+
+	result.remove(TAG_FIELD);
+
+	QJsonObject message;
+	message["jsonrpc"] = "2.0";
+	message["id"] = pending.id;
+	message["result"] = QJsonObject::fromVariantMap(result);
+
+	write(pending.socket, message);
+}
+
+void Rpc_server::write(QLocalSocket * socket, const QJsonObject & message) noexcept {
+	socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact));
+	socket->write("\n");
+}
+
+void Rpc_server::reply_error(QLocalSocket * socket, const QJsonValue & id, const int code, const QString & message) noexcept {
+
+	if(id.isUndefined()) {
+		return;
+	}
+
+	QJsonObject error;
+	error["code"] = code;
+	error["message"] = message;
+
+	QJsonObject reply;
+	reply["jsonrpc"] = "2.0";
+	reply["id"] = id;
+	reply["error"] = error;
+
+	write(socket, reply);
+}
@@ -0,0 +1,163 @@
+#include "sharded-counters.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+using namespace firebase;
+using namespace firestore;
+
+DocumentReference Sharded_counters::shard(const DocumentReference & counter, const int shards, const uint32_t salt) noexcept {
+
+	if(shards <= 1) {
+		return counter;
+	}
+
+	return counter.Collection("shards").Document(std::to_string(salt % static_cast<uint32_t>(std::min(shards, MAX_SHARDS))));
+}
+
+void Sharded_counters::add_fields(Result & result, const DocumentSnapshot & doc, const std::vector<std::string> & fields) noexcept {
+
+	if(!doc.exists()) {
+		return;
+	}
+
+	result.exists = true;
+
+	for(const auto & field : fields) {
+		const auto value = doc.Get(field);
+
+		if(value.is_integer()) {
+			result.totals[field] += value.integer_value();
+		}
+	}
+}
+
+void Sharded_counters::read(const DocumentReference & counter, const std::vector<std::string> & fields, Callback callback, const Source source) noexcept {
+
+	struct State {
+		std::mutex mutex;
+		int remaining = 2;
+		Result result;
+	};
+
+	auto state = std::make_shared<State>();
+
+	for(const auto & field : fields) {
+		state->result.totals[field] = 0;
+	}
+
+	const auto settle = [state, callback]() {
+		callback(state->result);
+	};
+
+	counter.Get(source).OnCompletion([state, fields, settle](const Future<DocumentSnapshot> & future) {
+		bool last = false;
+
+		{
+			std::lock_guard lock(state->mutex);
+
+			if(future.error() != Error::kErrorOk) {
+				state->result.error = true;
+			} else {
+				add_fields(state->result, *future.result(), fields);
+			}
+
+			last = --state->remaining == 0;
+		}
+
+		if(last) {
+			settle();
+		}
+	});
+
+	counter.Collection("shards").Get(source).OnCompletion([state, fields, settle](const Future<QuerySnapshot> & future) {
+		bool last = false;
+
+		{
+			std::lock_guard lock(state->mutex);
+
+			if(future.error() != Error::kErrorOk) {
+				state->result.error = true;
+			} else {
+				for(const auto & doc : future.result()->documents()) {
+					add_fields(state->result, doc, fields);
+				}
+			}
+
+			last = --state->remaining == 0;
+		}
+
+		if(last) {
+			settle();
+		}
+	});
+}
+
+std::vector<ListenerRegistration> Sharded_counters::listen(const DocumentReference & counter, const std::vector<std::string> & fields, Callback callback) noexcept {
+
+	struct State {
+		std::mutex mutex;
+		std::optional<Result> base;
+		std::optional<Result> shards;
+	};
+
+	auto state = std::make_shared<State>();
+
+	// called with the state locked, the two listeners may fire on different threads
+	const auto report = [fields, callback](const State & state) {
+
+		if(!state.base || !state.shards) {
+			return;
+		}
+
+		Result result;
+		result.error = state.base->error || state.shards->error;
+		result.exists = state.base->exists || state.shards->exists;
+
+		for(const auto & field : fields) {
+			result.totals[field] = state.base->totals.count(field) ? state.base->totals.at(field) : 0;
+
+			if(const auto it = state.shards->totals.find(field); it != state.shards->totals.end()) {
+				result.totals[field] += it->second;
+			}
+		}
+
+		callback(result);
+	};
+
+	std::vector<ListenerRegistration> registrations;
+
+	registrations.push_back(counter.AddSnapshotListener([state, fields, report](const DocumentSnapshot & doc, const Error error, const std::string &) {
+		Result result;
+
+		if(error != Error::kErrorOk) {
+			result.error = true;
+		} else {
+			add_fields(result, doc, fields);
+		}
+
+		std::lock_guard lock(state->mutex);
+		state->base = std::move(result);
+		report(*state);
+	}));
+
+	registrations.push_back(counter.Collection("shards").AddSnapshotListener([state, fields, report](const QuerySnapshot & snapshot, const Error error, const std::string &) {
+		Result result;
+
+		if(error != Error::kErrorOk) {
+			result.error = true;
+		} else {
+			for(const auto & doc : snapshot.documents()) {
+				add_fields(result, doc, fields);
+			}
+		}
+
+		std::lock_guard lock(state->mutex);
+		state->shards = std::move(result);
+		report(*state);
+	}));
+
+	return registrations;
+}
@@ -0,0 +1,268 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Controls.Material
+
+Popup {
+	id: root
+	modal: true
+	focus: true
+
+	anchors.centerIn: parent
+	width: parent.width * 0.8
+	height: parent.height * 0.8
+
+	property int _fontSize: 15
+	property bool loaded: false
+	property bool loading: false
+
+	// each breakdown as the dimensions get_analytics groups by, and the columns worth showing for it
+	readonly property var breakdowns: [
+		{ label: qsTr("Sales by customer by month"), by: "customer", then: "month", columns: ["baleSold", "weightSold", "amount", "receivedAmount"] },
+		{ label: qsTr("Rate distribution by month"), by: "month", then: "rate", columns: ["records", "baleSold", "weightSold", "amount"] },
+		{ label: qsTr("Average bale weight per customer"), by: "customer", then: "", columns: ["baleSold", "weightSold", "averageBaleWeight"] },
+		{ label: qsTr("Sales by month"), by: "month", then: "", columns: ["records", "baleSold", "weightSold", "amount", "receivedAmount"] }
+	]
+
+	readonly property var columnNames: ({
+		records: qsTr("Records"),
+		baleSold: qsTr("Bales"),
+		weightSold: qsTr("Weight"),
+		amount: qsTr("Amount"),
+		receivedAmount: qsTr("Received"),
+		averageBaleWeight: qsTr("Avg Bale Weight")
+	})
+
+	property var columns: breakdowns[0].columns
+
+	background: Rectangle {
+		color: Material.background
+		radius: 8
+		border.width: 0
+	}
+
+	function load() {
+		open();
+
+		if(loaded || loading) {
+			return;
+		}
+
+		const to = new Date(year, month - 1, day);
+		const from = new Date(to);
+		from.setFullYear(to.getFullYear() - 1);
+
+		fromField.text = Qt.formatDate(from, "dd-MM-yyyy");
+		toField.text = Qt.formatDate(to, "dd-MM-yyyy");
+		reload();
+	}
+
+	function reload() {
+		loading = true;
+		resultModel.clear();
+		statusLabel.text = qsTr("Loading records...");
+
+		firebase.load_analytics(fromField.text, toField.text);
+	}
+
+	function query() {
+		const breakdown = breakdowns[breakdownBox.currentIndex];
+
+		columns = breakdown.columns;
+
+		firebase.get_analytics({
+			by: breakdown.by,
+			then: breakdown.then,
+			customer: customerField.text,
+			rateWidth: rateWidthBox.value
+		});
+	}
+
+	Connections {
+		target: firebase
+
+		function onLoadAnalyticsProgress(progress) {
+			statusLabel.text = qsTr("Loading records... %1 days, %2 records").arg(progress.days).arg(formatNumber(progress.records));
+		}
+
+		function onLoadAnalyticsResponse(data) {
+			loading = false;
+
+			if(data.error) {
+				loaded = false;
+				statusLabel.text = "";
+				snackbar.showError("Error loading records for analytics.");
+				return;
+			}
+
+			loaded = true;
+			query();
+		}
+
+		function onGetAnalyticsResponse(data) {
+			resultModel.clear();
+
+			if(data.error) {
+				snackbar.showError("Error computing the breakdown.");
+				return;
+			}
+
+			if(data.empty) {
+				statusLabel.text = qsTr("No matching records.");
+				return;
+			}
+
+			for(const row of data.rows) {
+				resultModel.append({
+					group: [row.customer, row.month, row.rate].filter(key => key !== undefined).join("  /  "),
+					values: columns.map(column => column === "averageBaleWeight" ? row[column].toFixed(1) : formatNumber(row[column])).join("|")
+				});
+			}
+
+			statusLabel.text = qsTr("%1 groups over %2 records in %3 ms%4")
+				.arg(formatNumber(data.groups))
+				.arg(formatNumber(data.records))
+				.arg(data.elapsedMs.toFixed(1))
+				.arg(data.truncated ? qsTr(", first %1 shown").arg(data.rows.length) : "");
+		}
+	}
+
+	ListModel {
+		id: resultModel
+	}
+
+	ColumnLayout {
+		anchors.fill: parent
+		anchors.margins: 20
+		spacing: 12
+
+		Label {
+			text: qsTr("Analytics")
+			font.pointSize: 24
+			font.bold: true
+			Layout.fillWidth: true
+			horizontalAlignment: Text.AlignHCenter
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+			spacing: 10
+
+			TextField {
+				id: fromField
+				placeholderText: "From (DD-MM-YYYY)"
+				font.pointSize: _fontSize - 2
+				Layout.preferredWidth: 150
+			}
+
+			TextField {
+				id: toField
+				placeholderText: "To (DD-MM-YYYY)"
+				font.pointSize: _fontSize - 2
+				Layout.preferredWidth: 150
+			}
+
+			Button {
+				text: qsTr("Load")
+				enabled: !loading
+				font.pointSize: _fontSize - 2
+				onClicked: reload()
+			}
+
+			Item {
+				Layout.fillWidth: true
+			}
+
+			ComboBox {
+				id: breakdownBox
+				model: breakdowns.map(breakdown => breakdown.label)
+				font.pointSize: _fontSize - 2
+				Layout.preferredWidth: 300
+				onActivated: if(loaded) query()
+			}
+
+			TextField {
+				id: customerField
+				placeholderText: "Customer"
+				font.pointSize: _fontSize - 2
+				Layout.preferredWidth: 160
+				onEditingFinished: if(loaded) query()
+			}
+
+			Label {
+				text: qsTr("Rate step")
+				font.pointSize: _fontSize - 3
+			}
+
+			SpinBox {
+				id: rateWidthBox
+				from: 1
+				to: 100
+				value: 5
+				font.pointSize: _fontSize - 2
+				onValueModified: if(loaded) query()
+			}
+		}
+
+		Label {
+			id: statusLabel
+			font.pointSize: _fontSize - 3
+			Layout.fillWidth: true
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+
+			Label {
+				text: qsTr("Group")
+				font.pointSize: _fontSize
+				font.bold: true
+				Layout.fillWidth: true
+			}
+
+			Repeater {
+				model: columns
+
+				Label {
+					text: columnNames[modelData]
+					font.pointSize: _fontSize
+					font.bold: true
+					horizontalAlignment: Text.AlignRight
+					Layout.preferredWidth: 130
+				}
+			}
+		}
+
+		ListView {
+			Layout.fillWidth: true
+			Layout.fillHeight: true
+			clip: true
+			model: resultModel
+
+			ScrollBar.vertical: ScrollBar {}
+
+			delegate: RowLayout {
+				width: ListView.view.width
+				height: 32
+
+				Label {
+					text: model.group
+					font.pointSize: _fontSize - 1
+					elide: Text.ElideRight
+					Layout.fillWidth: true
+				}
+
+				Repeater {
+					model: values.split("|")
+
+					Label {
+						text: modelData
+						font.pointSize: _fontSize - 1
+						horizontalAlignment: Text.AlignRight
+						Layout.preferredWidth: 130
+					}
+				}
+			}
+		}
+	}
+}
@@ -15,13 +15,6 @@ Popup {
 	property int baleAmount;
 	property int baleWeight;
 
-	Component.onCompleted: {
-		if(typeof firebase !== 'undefined') {
-			loadingPopup.show();
-			firebase.get_bale();
-		}
-	}
-
 	background: Rectangle {
 		color: Material.background
 		radius: 8
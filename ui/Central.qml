@@ -20,7 +20,43 @@ Item {
 				return;
 			}
 
-			monthlyTotalsPopup.show(data);
+			lazy(monthlyTotalsLoader).show(data);
+			loadingPopup.close();
+		}
+
+		function onGetYearlyTotalsResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching yearly totals.");
+				loadingPopup.close();
+				return;
+			}
+
+			lazy(monthlyTotalsLoader).showYearly(data);
+			loadingPopup.close();
+		}
+
+		function onGetRangeTotalsResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching range totals.");
+				loadingPopup.close();
+				return;
+			}
+
+			lazy(monthlyTotalsLoader).showRange(data);
+			loadingPopup.close();
+		}
+
+		function onGetConsolidatedTotalsResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching totals from every warehouse.");
+				loadingPopup.close();
+				return;
+			}
+
+			lazy(monthlyTotalsLoader).showConsolidated(data);
 			loadingPopup.close();
 		}
 
@@ -35,11 +71,11 @@ Item {
 			if(data.empty) {
 				snackbar.showError("Customer does not exist in the database.");
 				loadingPopup.close();
-				namedRecordPopup.focusNameField();
+				lazy(namedRecordLoader).focusNameField();
 				return;
 			}
 
-			userRecordPopup.setMetadata(data);
+			lazy(userRecordLoader).setMetadata(data);
 		}
 
 		function onGetUserRecordsResponse(data) {
@@ -47,9 +83,8 @@ Item {
 			if(data.error) {
 				snackbar.showError("Error fetching records.");
 			} else if(!data.empty) {
-				namedRecordPopup.close();
-				userRecordPopup.setModel(data);
-				userRecordPopup.open();
+				lazy(namedRecordLoader).close();
+				lazy(userRecordLoader).open();
 			} else {
 				snackbar.showError("Customer exists but has no records (This should not happen!).");
 			}
@@ -59,66 +94,91 @@ Item {
 	}
 
 	function clearModel() {
-		recordModel.clear();
+		firebase.dailyRecords.clear();
 	}
 
 	function removeRow(docID) {
+		firebase.dailyRecords.remove_record(docID);
+	}
+
+	function addRecord(record) {
+		firebase.dailyRecords.add_record(record);
+	}
 
-		for(let i = 0; i < recordModel.count; i++) {
+	Menu {
+		id: totalsMenu
+		font.pointSize: _fontSize - 2
 
-			if(recordModel.get(i).docID === docID) {
-				recordModel.remove(i);
-				return;
+		MenuItem {
+			text: "Get Monthly Totals"
+
+			onTriggered: {
+				loadingPopup.open();
+				firebase.get_monthly_totals(month, year);
 			}
 		}
-	}
 
-	function setModel(data) {
-		recordModel.clear();
+		MenuItem {
+			text: "Get Yearly Totals"
 
-		if(data.empty) {
-			return;
+			onTriggered: {
+				loadingPopup.open();
+				firebase.get_yearly_totals(year);
+			}
 		}
 
-		data.records.forEach(function(item) {
-
-			recordModel.append({
-				docID: item.docID,
-				name: item.name,
-				baleSold: item.baleSold,
-				weightSold: item.weightSold,
-				rate: item.rate.toFixed(1),
-				amount: item.amount,
-				receivedAmount: item.receivedAmount
-			});
-		});
-	}
+		MenuItem {
+			text: "Get Last 90 Days Totals"
 
-	function addRecord(record) {
+			onTriggered: {
+				const to = new Date(year, month - 1, day);
+				const from = new Date(to);
+				from.setDate(to.getDate() - 89);
 
-		recordModel.append({
-			docID: record.docID,
-			name: record.name,
-			baleSold: record.baleSold,
-			weightSold: record.weightSold,
-			rate: record.rate.toFixed(1),
-			amount: record.amount,
-			receivedAmount: record.receivedAmount
-		});
-	}
+				loadingPopup.open();
+				firebase.get_range_totals(Qt.formatDate(from, "dd-MM-yyyy"), Qt.formatDate(to, "dd-MM-yyyy"));
+			}
+		}
 
-	Menu {
-		id: totalsMenu
-		font.pointSize: _fontSize - 2
+		MenuItem {
+			text: "Get Day Totals of All Warehouses"
+
+			onTriggered: {
+				loadingPopup.open();
+				firebase.get_consolidated_daily_totals(getDate());
+			}
+		}
 
 		MenuItem {
-			text: "Get Monthly Totals"
+			text: "Get Monthly Totals of All Warehouses"
 
 			onTriggered: {
 				loadingPopup.open();
-				firebase.get_monthly_totals(month, year);
+				firebase.get_consolidated_monthly_totals(month, year);
 			}
 		}
+
+		MenuItem {
+			text: "Debtors"
+
+			onTriggered: lazy(debtorsLoader).load()
+		}
+
+		MenuItem {
+			text: "Analytics"
+
+			onTriggered: lazy(analyticsLoader).load()
+		}
+
+		MenuSeparator {}
+
+		MenuItem {
+			text: "Live Updates"
+			checkable: true
+			checked: firebase.liveUpdates
+
+			onTriggered: firebase.liveUpdates = checked
+		}
 	}
 
 	function recordUnderMouse() {
@@ -186,11 +246,7 @@ Item {
 			clip: true
 			orientation: ListView.Vertical
 
-			ListModel {
-				id: recordModel
-			}
-
-			model: recordModel
+			model: firebase.dailyRecords
 
 			delegate: Item {
 				width: ListView.view.width
@@ -255,7 +311,7 @@ Item {
 					}
 
 					TextField {
-						text: model.rate
+						text: model.rate.toFixed(1)
 						readOnly: true
 						horizontalAlignment: Text.AlignHCenter
 						font.pointSize: _fontSize
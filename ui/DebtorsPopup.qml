@@ -0,0 +1,174 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Controls.Material
+
+Popup {
+	id: root
+	modal: true
+	focus: true
+
+	anchors.centerIn: parent
+	width: parent.width * 0.6
+	height: parent.height * 0.7
+
+	property int _fontSize: 15
+	property int topCount: 20
+
+	background: Rectangle {
+		color: Material.background
+		radius: 8
+		border.width: 0
+	}
+
+	function load() {
+		agingModel.clear();
+		debtorModel.clear();
+		totalDebtLabel.text = "";
+
+		firebase.get_debt_aging();
+		firebase.get_top_debtors(topCount);
+		open();
+	}
+
+	Connections {
+		target: firebase
+
+		function onGetDebtAgingResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching debt aging.");
+				return;
+			}
+
+			agingModel.clear();
+
+			for(const bucket of data.buckets) {
+				agingModel.append(bucket);
+			}
+
+			totalDebtLabel.text = qsTr("Total Outstanding: ") + formatNumber(data.totalDebt);
+		}
+
+		function onGetTopDebtorsResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching top debtors.");
+				return;
+			}
+
+			debtorModel.clear();
+
+			for(const debtor of data.debtors) {
+				debtorModel.append(debtor);
+			}
+		}
+	}
+
+	ListModel {
+		id: agingModel
+	}
+
+	ListModel {
+		id: debtorModel
+	}
+
+	ColumnLayout {
+		anchors.fill: parent
+		anchors.margins: 20
+		spacing: 15
+
+		Label {
+			text: qsTr("Debtors")
+			font.pointSize: 24
+			font.bold: true
+			Layout.fillWidth: true
+			horizontalAlignment: Text.AlignHCenter
+		}
+
+		Label {
+			id: totalDebtLabel
+			font.pointSize: _fontSize
+			Layout.fillWidth: true
+			horizontalAlignment: Text.AlignHCenter
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+			spacing: 10
+
+			Repeater {
+				model: agingModel
+
+				Pane {
+					Layout.fillWidth: true
+					Material.elevation: 2
+
+					ColumnLayout {
+						anchors.fill: parent
+
+						Label {
+							text: model.label
+							font.pointSize: _fontSize - 2
+							Layout.alignment: Qt.AlignHCenter
+						}
+
+						Label {
+							text: formatNumber(model.debt)
+							font.pointSize: _fontSize + 4
+							font.weight: Font.Bold
+							color: Material.accent
+							Layout.alignment: Qt.AlignHCenter
+						}
+
+						Label {
+							text: qsTr("%1 customers").arg(model.customers)
+							font.pointSize: _fontSize - 4
+							Layout.alignment: Qt.AlignHCenter
+						}
+					}
+				}
+			}
+		}
+
+		Label {
+			text: qsTr("Top %1 Debtors").arg(topCount)
+			font.pointSize: _fontSize + 2
+			font.bold: true
+		}
+
+		ListView {
+			Layout.fillWidth: true
+			Layout.fillHeight: true
+			clip: true
+			model: debtorModel
+
+			ScrollBar.vertical: ScrollBar {}
+
+			delegate: RowLayout {
+				width: ListView.view.width
+				height: 36
+
+				Label {
+					text: model.name
+					font.pointSize: _fontSize
+					Layout.fillWidth: true
+				}
+
+				Label {
+					text: model.lastPayment ? qsTr("paid ") + model.lastPayment : qsTr("never paid")
+					font.pointSize: _fontSize - 3
+					Layout.preferredWidth: 160
+				}
+
+				Label {
+					text: formatNumber(model.debt)
+					font.pointSize: _fontSize
+					font.weight: Font.Bold
+					horizontalAlignment: Text.AlignRight
+					Layout.preferredWidth: 140
+				}
+			}
+		}
+	}
+}
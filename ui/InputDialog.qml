@@ -231,7 +231,7 @@ Dialog {
 								}
 
 								Text {
-									text: name
+									text: phone ? name + "  -  " + phone : name
 									width: parent.width
 									horizontalAlignment: Text.AlignHCenter
 									verticalAlignment: Text.AlignVCenter
@@ -0,0 +1,116 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import QtQuick.Controls.Material
+
+// debug view of firebase.tracer, toggled with Ctrl+Shift+L
+Rectangle {
+	id: root
+	visible: false
+	color: "#E0202020"
+	radius: 8
+	z: 99999
+
+	width: 820
+	height: Math.min(420, grid.implicitHeight + 70)
+
+	property var rows: []
+
+	function refresh() {
+		rows = firebase.tracer.summary();
+	}
+
+	function format(ms) {
+		return Number(ms).toFixed(1);
+	}
+
+	onVisibleChanged: {
+
+		if(visible) {
+			refresh();
+		}
+	}
+
+	Timer {
+		interval: 1000
+		repeat: true
+		running: root.visible
+		onTriggered: root.refresh()
+	}
+
+	ColumnLayout {
+		anchors.fill: parent
+		anchors.margins: 12
+		spacing: 8
+
+		RowLayout {
+			Layout.fillWidth: true
+
+			Label {
+				text: qsTr("Latency (ms) — p99 per phase")
+				font.bold: true
+				Layout.fillWidth: true
+			}
+
+			Button {
+				text: qsTr("Dump Trace")
+				flat: true
+
+				onClicked: {
+					const path = firebase.tracer.dump();
+					snackbar.showInfo(path ? qsTr("Trace written to ") + path : qsTr("Failed to write trace."));
+				}
+			}
+
+			Button {
+				text: qsTr("Reset")
+				flat: true
+
+				onClicked: {
+					firebase.tracer.reset();
+					root.refresh();
+				}
+			}
+		}
+
+		GridLayout {
+			id: grid
+			columns: 9
+			columnSpacing: 16
+			rowSpacing: 4
+
+			Repeater {
+				model: ["Operation", "Count", "p50", "p99", "Max", "Firestore", "Callback", "Queue", "QML"]
+
+				Label {
+					text: modelData
+					font.bold: true
+					color: Material.accent
+				}
+			}
+
+			Repeater {
+				model: root.rows.length * 9
+
+				Label {
+					readonly property var row: root.rows[Math.floor(index / 9)]
+					readonly property int column: index % 9
+
+					text: {
+						switch(column) {
+							case 0: return row.op;
+							case 1: return row.count;
+							case 2: return format(row.p50);
+							case 3: return format(row.p99);
+							case 4: return format(row.max);
+							case 5: return format(row.storeP99);
+							case 6: return format(row.callbackP99);
+							case 7: return format(row.queueP99);
+							default: return format(row.handlerP99);
+						}
+					}
+				}
+			}
+		}
+	}
+}
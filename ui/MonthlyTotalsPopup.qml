@@ -24,8 +24,10 @@ Popup {
 	property int totalWeightSold: 0
 	property int totalAmount: 0
 	property int totalReceivedAmount: 0
+	property var sites: []
 
 	function show(data) {
+		sites = [];
 		const monthName = Qt.locale().monthName(data.month - 1);
 		headingLabel.text = qsTr("Monthly Totals - %1").arg(monthName);
 
@@ -37,6 +39,45 @@ Popup {
 		open();
 	}
 
+	function showRange(data) {
+		sites = [];
+		headingLabel.text = qsTr("Totals - %1 to %2").arg(data.from).arg(data.to);
+
+		totalBaleSold = data.totalBaleSold;
+		totalWeightSold = data.totalWeightSold;
+		totalAmount = data.totalAmount;
+		totalReceivedAmount = data.totalReceivedAmount;
+
+		open();
+	}
+
+	function showYearly(data) {
+		sites = [];
+		headingLabel.text = qsTr("Yearly Totals - %1").arg(data.year);
+
+		totalBaleSold = data.totalBaleSold;
+		totalWeightSold = data.totalWeightSold;
+		totalAmount = data.totalAmount;
+		totalReceivedAmount = data.totalReceivedAmount;
+
+		open();
+	}
+
+	// the merged totals, with what each warehouse put in them below
+	function showConsolidated(data) {
+		headingLabel.text = data.scope === "day"
+			? qsTr("All Warehouses - %1").arg(data.date)
+			: qsTr("All Warehouses - %1 %2").arg(Qt.locale().monthName(data.month - 1)).arg(data.year);
+
+		totalBaleSold = data.totalBaleSold;
+		totalWeightSold = data.totalWeightSold;
+		totalAmount = data.totalAmount;
+		totalReceivedAmount = data.totalReceivedAmount;
+		sites = data.sites;
+
+		open();
+	}
+
 	Rectangle {
 		anchors.fill: parent
 		color: Material.background
@@ -150,6 +191,22 @@ Popup {
 						horizontalAlignment: Text.AlignHCenter
 					}
 				}
+
+				Repeater {
+					model: sites
+
+					Label {
+						Layout.fillWidth: true
+						font.pointSize: _fontSize - 2
+						horizontalAlignment: Text.AlignHCenter
+						text: qsTr("%1: %2 bales, %3 kg, %4 amount, %5 received")
+							.arg(modelData.warehouse)
+							.arg(formatNumber(modelData.totalBaleSold))
+							.arg(formatNumber(modelData.totalWeightSold))
+							.arg(formatNumber(modelData.totalAmount))
+							.arg(formatNumber(modelData.totalReceivedAmount))
+					}
+				}
 			}
 		}
 	}
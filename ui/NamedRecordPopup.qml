@@ -101,10 +101,10 @@ Popup {
 			TextField {
 				id: nameField
 				Layout.fillWidth: true
-				placeholderText: "Enter customer's name"
+				placeholderText: "Enter customer's name or phone"
 				font.pointSize: _fontSize
 				horizontalAlignment: Text.AlignHCenter
-				validator: RegularExpressionValidator { regularExpression: /^[a-zA-Z ]+$/ }
+				validator: RegularExpressionValidator { regularExpression: /^[a-zA-Z0-9 +]+$/ }
 				property bool suppress: false
 
 				onTextChanged: {
@@ -167,7 +167,7 @@ Popup {
 							}
 
 							Text {
-								text: name
+								text: phone ? name + "  -  " + phone : name
 								width: parent.width
 								horizontalAlignment: Text.AlignHCenter
 								verticalAlignment: Text.AlignVCenter
@@ -226,6 +226,22 @@ Popup {
 							return;
 						}
 
+						// a phone number opens the customer it matches, ranked against the field as it is now. the
+						// suggestions may still be those of what was typed before the last keystrokes
+						if(/[0-9]/.test(nameField.text)) {
+							const name = firebase.best_customer(nameField.text);
+
+							if(name.length === 0) {
+								snackbar.showError("No customer has that phone number.");
+								nameField.forceActiveFocus();
+								return;
+							}
+
+							nameField.suppress = true;
+							nameField.text = name;
+							nameField.suppress = false;
+						}
+
 						wasSubmitted = true;
 						loadingPopup.open();
 
@@ -21,7 +21,18 @@ Popup {
 	}
 
 	function clearModel() {
-		recordModel.clear();
+		firebase.userRecords.clear();
+	}
+
+	Connections {
+		target: firebase
+
+		function onGetMoreUserRecordsResponse(data) {
+
+			if(data.error) {
+				snackbar.showError("Error fetching more records.");
+			}
+		}
 	}
 
 	property int totalBaleSold: 0
@@ -54,27 +65,6 @@ Popup {
 		debt = data.debt;
 	}
 
-	function setModel(data) {
-		recordModel.clear();
-
-		if(data.empty) {
-			return;
-		}
-
-		data.records.forEach(function(item) {
-
-			recordModel.append({
-				docID: item.docID,
-				baleSold: item.baleSold,
-				weightSold: item.weightSold,
-				rate: item.rate.toFixed(1),
-				amount: item.amount,
-				receivedAmount: item.receivedAmount,
-				date: item.date
-			});
-		});
-	}
-
 	Rectangle {
 		anchors.fill: parent
 		color: Material.background
@@ -312,11 +302,15 @@ Popup {
 					clip: true
 					orientation: ListView.Vertical
 
-					ListModel {
-						id: recordModel
-					}
+					model: firebase.userRecords
+
+					// the history arrives a page at a time, newest first
+					onAtYEndChanged: {
 
-					model: recordModel
+						if(atYEnd && count > 0) {
+							firebase.get_more_user_records();
+						}
+					}
 
 					delegate: Item {
 						width: ListView.view.width
@@ -351,7 +345,7 @@ Popup {
 							}
 
 							TextField {
-								text: model.rate
+								text: model.rate.toFixed(1)
 								readOnly: true
 								horizontalAlignment: Text.AlignHCenter
 								font.pointSize: _fontSize
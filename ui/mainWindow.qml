@@ -39,8 +39,24 @@ ApplicationWindow {
 
 	Component.onCompleted: {
 		suppressClosingLoadingPopup = false;
+		firebase.get_bale();
+		loadDay();
+	}
+
+	// instantiates a rarely used popup the first time it is needed
+	function lazy(loader) {
+		loader.active = true;
+		return loader.item;
+	}
+
+	function loadDay() {
 		loadingPopup.open();
-		firebase.get_daily_records(getDate());
+
+		if(firebase.liveUpdates) {
+			firebase.subscribe_daily_records(getDate());
+		} else {
+			firebase.get_daily_records(getDate());
+		}
 	}
 
 	function getDate() {
@@ -61,7 +77,7 @@ ApplicationWindow {
 			if(autocompleteBy === "inputDialog") {
 				inputDialog.populateAutocomplete(data);
 			} else if(autocompleteBy === "namedPopup") {
-				namedRecordPopup.populateAutocomplete(data);
+				lazy(namedRecordLoader).populateAutocomplete(data);
 			}
 		}
 
@@ -110,7 +126,7 @@ ApplicationWindow {
 				baleAmount = response.baleAmount;
 				baleWeight = response.baleWeight;
 				snackbar.showInfo("Bale data updated successfully.");
-				baleDialog.close();
+				lazy(baleDialogLoader).close();
 			}
 
 			loadingPopup.hide();
@@ -140,12 +156,61 @@ ApplicationWindow {
 			}
 		}
 
+		function onLiveUpdatesChanged() {
+
+			if(firebase.liveUpdates) {
+				firebase.subscribe_daily_records(getDate());
+			}
+		}
+
+		function onDailyTotalsChanged(data) {
+
+			if(data.error) {
+				snackbar.showError("Live update of the totals failed.");
+				return;
+			}
+
+			totalAmount = data.empty ? 0 : data.totalAmount;
+			totalBaleSold = data.empty ? 0 : data.totalBaleSold;
+			totalWeightSold = data.empty ? 0 : data.totalWeightSold;
+			totalReceivedAmount = data.empty ? 0 : data.totalReceivedAmount;
+		}
+
+		function onJournalEntryRejected(response) {
+			snackbar.showError((response.op === "delete" ? "A deletion" : "A sale") + " of " + response.name + " on " + response.date + " was refused and set aside: " + response.reason);
+		}
+
+		function onWarehouseChanged() {
+			central.clearModel();
+			firebase.get_bale();
+			loadDay();
+		}
+
+		function onAddWarehouseResponse(response) {
+
+			// the new site is switched to once it exists
+			const switching = warehouseBox.addingSite;
+			warehouseBox.addingSite = false;
+
+			if(response.error) {
+				snackbar.showError("Error adding the warehouse.");
+			} else if(switching) {
+				firebase.warehouse = response.warehouse;
+			}
+		}
+
+		function onStockChanged(response) {
+
+			if(!response.error) {
+				baleAmount = response.baleAmount;
+				baleWeight = response.baleWeight;
+			}
+		}
+
 		function onGetDailyRecordsResponse(records) {
 
 			if(records.error) {
 				snackbar.showError("Error fetching records.");
-			} else {
-				central.setModel(records);
 			}
 
 			loadingPopup.close();
@@ -156,9 +221,8 @@ ApplicationWindow {
 		id: datePickerDialog
 
 		onDateChanged: {
-			loadingPopup.open();
 			central.clearModel();
-			firebase.get_daily_records(getDate());
+			loadDay();
 		}
 	}
 
@@ -178,26 +242,99 @@ ApplicationWindow {
 		}
 	}
 
-	NamedRecordPopup {
-		id: namedRecordPopup
+	Loader {
+		id: namedRecordLoader
+		active: false
+
+		sourceComponent: Component {
+			NamedRecordPopup {
+				parent: Overlay.overlay
+			}
+		}
 	}
 
-	UserRecordPopup {
-		id: userRecordPopup
+	Loader {
+		id: userRecordLoader
+		active: false
+
+		sourceComponent: Component {
+			UserRecordPopup {
+				parent: Overlay.overlay
+			}
+		}
 	}
 
-	MonthlyTotalsPopup {
-		id: monthlyTotalsPopup
+	Loader {
+		id: monthlyTotalsLoader
+		active: false
+
+		sourceComponent: Component {
+			MonthlyTotalsPopup {
+				parent: Overlay.overlay
+			}
+		}
+	}
+
+	Loader {
+		id: debtorsLoader
+		active: false
+
+		sourceComponent: Component {
+			DebtorsPopup {
+				parent: Overlay.overlay
+			}
+		}
+	}
+
+	Loader {
+		id: analyticsLoader
+		active: false
+
+		sourceComponent: Component {
+			AnalyticsPopup {
+				parent: Overlay.overlay
+			}
+		}
 	}
 
 	LoadingPopup {
 		id: loadingPopup
 	}
 
-	BaleDialog {
-		id: baleDialog
-		baleAmount: mainWindow.baleAmount
-		baleWeight: mainWindow.baleWeight
+	Loader {
+		id: latencyLoader
+		active: false
+
+		sourceComponent: Component {
+			LatencyOverlay {
+				parent: Overlay.overlay
+				anchors.right: parent.right
+				anchors.top: parent.top
+				anchors.margins: 20
+			}
+		}
+	}
+
+	Shortcut {
+		sequence: "Ctrl+Shift+L"
+
+		onActivated: {
+			const overlay = lazy(latencyLoader);
+			overlay.visible = !overlay.visible;
+		}
+	}
+
+	Loader {
+		id: baleDialogLoader
+		active: false
+
+		sourceComponent: Component {
+			BaleDialog {
+				parent: Overlay.overlay
+				baleAmount: mainWindow.baleAmount
+				baleWeight: mainWindow.baleWeight
+			}
+		}
 	}
 
 	Rectangle {
@@ -311,7 +448,7 @@ ApplicationWindow {
 					text: qsTr("Customer Record");
 
 					onClicked: {
-						namedRecordPopup.open();
+						lazy(namedRecordLoader).open();
 					}
 				}
 
@@ -339,9 +476,45 @@ ApplicationWindow {
 					text: qsTr("Bale in Stock: ") + formatNumber(baleWeight) + " kg"
 
 					onClicked: {
-						baleDialog.open();
+						lazy(baleDialogLoader).open();
+					}
+				}
+
+				ComboBox {
+					id: warehouseBox
+					Layout.alignment: Qt.AlignCenter
+					Layout.preferredWidth: 180
+					font.pointSize: 12
+					editable: true
+					model: firebase.warehouses
+					currentIndex: firebase.warehouses.indexOf(firebase.warehouse)
+
+					// a new site waiting on addWarehouseResponse
+					property bool addingSite: false
+
+					onActivated: firebase.warehouse = currentText
+
+					// a name not in the list starts a new site
+					onAccepted: {
+
+						if(find(editText) === -1) {
+							addingSite = true;
+							firebase.add_warehouse(editText);
+						} else {
+							firebase.warehouse = editText;
+						}
 					}
 				}
+
+				Label {
+					id: syncLabel
+					Layout.alignment: Qt.AlignCenter
+					font.pointSize: 11
+					visible: firebase.pendingWrites > 0
+					color: errorColor
+
+					text: qsTr("Syncing ") + firebase.pendingWrites + qsTr(" entries")
+				}
 			}
 		}
 